@@ -0,0 +1,1200 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <malloc.h>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "chunk_pool.h"
+#include "deque.h"
+#include "deque_algorithm.h"
+#include "deque_parallel.h"
+#include "ring_buffer.h"
+#include "small_deque.h"
+#include "spsc_deque.h"
+#include "static_deque.h"
+#include "thread_pool.h"
+#include "work_stealing_deque.h"
+
+struct Message {
+  std::string header;
+  std::vector<int> payload;
+
+  Message(const std::string& header, size_t payload_size) : header(header), payload(payload_size) {}
+};
+
+struct CountingValue {
+  static size_t moves;
+
+  int x = 0;
+
+  CountingValue(int x) : x(x) {}
+  CountingValue(const CountingValue& other) : x(other.x) {
+    ++moves;
+  }
+  CountingValue(CountingValue&& other) noexcept : x(other.x) {
+    ++moves;
+  }
+  CountingValue& operator=(const CountingValue& other) {
+    x = other.x;
+    ++moves;
+    return *this;
+  }
+  CountingValue& operator=(CountingValue&& other) noexcept {
+    x = other.x;
+    ++moves;
+    return *this;
+  }
+};
+
+size_t CountingValue::moves = 0;
+
+struct Record256 {
+  char data[256];
+
+  Record256(char c = 0) {
+    std::memset(data, c, sizeof(data));
+  }
+};
+
+template<typename T>
+struct CountingAllocator : public std::allocator<T> {
+  static size_t calls;
+
+  template<typename U>
+  struct rebind {
+    using other = CountingAllocator<U>;
+  };
+
+  CountingAllocator() = default;
+
+  template<typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    ++calls;
+    return std::allocator<T>::allocate(count);
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    ++calls;
+    std::allocator<T>::deallocate(ptr, count);
+  }
+};
+
+template<typename T>
+size_t CountingAllocator<T>::calls = 0;
+
+size_t PeakRssKb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+size_t CurrentRssKb() {
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  statm >> total_pages >> resident_pages;
+  return resident_pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+template<typename Func>
+int MeasureMs(Func&& func) {
+  using namespace std::chrono;
+
+  auto start = high_resolution_clock::now();
+  func();
+  auto finish = high_resolution_clock::now();
+  return duration_cast<milliseconds>(finish - start).count();
+}
+
+void EnqueueBenchmark() {
+  const size_t kCount = 1'000'000;
+  const std::string kHeader(64, 'h');
+
+  int copy_ms = MeasureMs([&] {
+    Deque<Message> d;
+    for (size_t i = 0; i < kCount; ++i) {
+      Message message(kHeader, 16);
+      d.push_back(message);
+    }
+  });
+
+  int move_ms = MeasureMs([&] {
+    Deque<Message> d;
+    for (size_t i = 0; i < kCount; ++i) {
+      Message message(kHeader, 16);
+      d.push_back(std::move(message));
+    }
+  });
+
+  int emplace_ms = MeasureMs([&] {
+    Deque<Message> d;
+    for (size_t i = 0; i < kCount; ++i) {
+      d.emplace_back(kHeader, 16);
+    }
+  });
+
+  std::cerr << "enqueue " << kCount << " messages: push_back(const T&) " << copy_ms
+            << " ms, push_back(T&&) " << move_ms << " ms, emplace_back " << emplace_ms << " ms" << std::endl;
+}
+
+void RandomInsertBenchmark() {
+  const size_t kInitial = 200'000;
+  const size_t kInserts = 20'000;
+  std::mt19937 gen(42);
+
+  Deque<CountingValue> d;
+  for (size_t i = 0; i < kInitial; ++i) {
+    d.emplace_back(i);
+  }
+  size_t rss_before = PeakRssKb();
+  CountingValue::moves = 0;
+  size_t tail_shift_moves = 0;
+
+  int ms = MeasureMs([&] {
+    for (size_t i = 0; i < kInserts; ++i) {
+      size_t index = gen() % (d.size() + 1);
+      tail_shift_moves += d.size() - index;
+      d.emplace(d.begin() + index, i);
+    }
+  });
+
+  std::cerr << "random insert x" << kInserts << " into " << kInitial << " elements: " << ms << " ms, "
+            << CountingValue::moves << " element moves (shifting the tail only: " << tail_shift_moves
+            << "), peak rss growth " << PeakRssKb() - rss_before << " KB" << std::endl;
+}
+
+template<typename T, typename ChunkPolicy>
+void ChunkPolicyRun(const char* name, size_t count) {
+  Deque<T, std::allocator<T>, ChunkPolicy> d;
+  size_t checksum = 0;
+
+  int push_ms = MeasureMs([&] {
+    for (size_t i = 0; i < count; ++i) {
+      d.push_back(T(i % 100));
+    }
+  });
+  int iterate_ms = MeasureMs([&] {
+    for (const auto& x: d) {
+      checksum += reinterpret_cast<const char&>(x);
+    }
+  });
+  int pop_ms = MeasureMs([&] {
+    while (d.size() > 0) {
+      d.pop_front();
+    }
+  });
+
+  std::cerr << "  " << name << " (" << ChunkPolicy::template chunk_size<T>() << " per chunk): push "
+            << push_ms << " ms, iterate " << iterate_ms << " ms, pop " << pop_ms << " ms"
+            << (checksum == 0 ? "!" : "") << std::endl;
+}
+
+template<typename T>
+void ChunkPolicyBenchmark(const char* type_name, size_t count) {
+  std::cerr << "chunk policies, " << count << " x " << type_name << ":" << std::endl;
+  ChunkPolicyRun<T, FixedChunkPolicy<32>>("fixed 32", count);
+  ChunkPolicyRun<T, SmallChunkPolicy>("512 B", count);
+  ChunkPolicyRun<T, PageChunkPolicy>("4 KB", count);
+  ChunkPolicyRun<T, ChunkSizePolicy<65536>>("64 KB", count);
+}
+
+template<typename Container>
+void RandomAccessRun(const char* name, size_t count, const std::vector<size_t>& indices) {
+  Container d;
+  for (size_t i = 0; i < count; ++i) {
+    d.push_back(int(i));
+  }
+  long long checksum = 0;
+
+  int random_ms = MeasureMs([&] {
+    for (size_t index: indices) {
+      checksum += d[index];
+    }
+  });
+  int scan_ms = MeasureMs([&] {
+    for (auto it = d.begin(), end = d.end(); it != end; ++it) {
+      checksum += *it;
+    }
+  });
+
+  std::cerr << "  " << name << ": random operator[] " << random_ms << " ms, linear scan " << scan_ms
+            << " ms (checksum " << checksum << ")" << std::endl;
+}
+
+void RandomAccessBenchmark() {
+  const size_t kCount = 10'000'000;
+  std::mt19937 gen(42);
+  std::vector<size_t> indices(20'000'000);
+  for (auto& index: indices) {
+    index = gen() % kCount;
+  }
+
+  std::cerr << "random access over " << kCount << " ints, " << indices.size() << " lookups:" << std::endl;
+  RandomAccessRun<Deque<int>>("Deque", kCount, indices);
+  RandomAccessRun<std::deque<int>>("std::deque", kCount, indices);
+}
+
+void MemoryBenchmark() {
+  const size_t kCount = 50'000'000;
+
+  for (bool front: {false, true}) {
+    size_t rss_before = CurrentRssKb();
+    {
+      Deque<int> d;
+      for (size_t i = 0; i < kCount; ++i) {
+        if (front) {
+          d.push_front(int(i));
+        } else {
+          d.push_back(int(i));
+        }
+      }
+      std::cerr << (front ? "push_front " : "push_back ") << kCount << " ints: rss growth "
+                << CurrentRssKb() - rss_before << " KB, payload " << kCount * sizeof(int) / 1024 << " KB"
+                << std::endl;
+    }
+  }
+}
+
+void FifoSoakBenchmark(size_t operations) {
+  const size_t kLength = 1000;
+  Deque<int> d;
+  for (size_t i = 0; i < kLength; ++i) {
+    d.push_back(int(i));
+  }
+  size_t rss_before = CurrentRssKb();
+
+  int ms = MeasureMs([&] {
+    for (size_t i = 1; i <= operations / 2; ++i) {
+      d.push_back(int(i));
+      d.pop_front();
+      if (i % (operations / 20) == 0) {
+        std::cerr << "  " << 2 * i << " operations, rss growth " << CurrentRssKb() - rss_before << " KB"
+                  << std::endl;
+      }
+    }
+  });
+
+  std::cerr << "fifo soak, length " << kLength << ", " << operations << " operations: " << ms << " ms"
+            << std::endl;
+}
+
+void OrderQueueBenchmark() {
+  const size_t kRounds = 10'000;
+  const size_t kBurst = 2'000;
+  Deque<int, CountingAllocator<int>> d;
+  for (size_t i = 0; i < kBurst; ++i) {
+    d.push_back(int(i));
+  }
+  CountingAllocator<int>::calls = 0;
+
+  // orders drain from the front, then a burst of new ones is queued at the front as well
+  int ms = MeasureMs([&] {
+    for (size_t round = 0; round < kRounds; ++round) {
+      for (size_t i = 0; i < kBurst / 2; ++i) {
+        d.pop_front();
+      }
+      for (size_t i = 0; i < kBurst / 2; ++i) {
+        d.push_front(int(i));
+      }
+      for (size_t i = 0; i < kBurst / 2; ++i) {
+        d.pop_back();
+      }
+      for (size_t i = 0; i < kBurst / 2; ++i) {
+        d.push_back(int(i));
+      }
+    }
+  });
+
+  std::cerr << "order queue, " << kRounds << " rounds of " << kBurst << "-element bursts: " << ms << " ms, "
+            << CountingAllocator<int>::calls << " chunk allocator calls" << std::endl;
+}
+
+void BulkLoadBenchmark() {
+  const size_t kCount = 100'000'000;
+  std::vector<int> batch(kCount);
+  for (size_t i = 0; i < kCount; ++i) {
+    batch[i] = int(i);
+  }
+
+  int push_ms = MeasureMs([&] {
+    Deque<int> d;
+    for (int x: batch) {
+      d.push_back(x);
+    }
+  });
+  int append_ms = MeasureMs([&] {
+    Deque<int> d;
+    d.append(batch.data(), batch.data() + kCount);
+  });
+  int range_ms = MeasureMs([&] {
+    Deque<int> d(batch.begin(), batch.end());
+  });
+  int resize_ms = MeasureMs([&] {
+    Deque<int> d;
+    d.resize(kCount, 1);
+  });
+  int stl_ms = MeasureMs([&] {
+    std::deque<int> d(batch.begin(), batch.end());
+  });
+
+  std::cerr << "bulk load " << kCount << " ints: push_back loop " << push_ms << " ms, append " << append_ms
+            << " ms, range constructor " << range_ms << " ms, resize " << resize_ms << " ms, std::deque range "
+            << stl_ms << " ms" << std::endl;
+}
+
+void SegmentScanBenchmark() {
+  const size_t kCount = 1'000'000;
+  const size_t kPasses = 500;
+  Deque<int> d;
+  d.resize(kCount, 1);
+  long long iterator_sum = 0;
+  long long segment_sum = 0;
+
+  int iterator_ms = MeasureMs([&] {
+    for (size_t pass = 0; pass < kPasses; ++pass) {
+      for (int x: d) {
+        iterator_sum += x;
+      }
+    }
+  });
+  int segment_ms = MeasureMs([&] {
+    for (size_t pass = 0; pass < kPasses; ++pass) {
+      d.for_each_segment([&](std::span<const int> segment) {
+        long long chunk_sum = 0;
+        for (int x: segment) {
+          chunk_sum += x;
+        }
+        segment_sum += chunk_sum;
+      });
+    }
+  });
+
+  std::cerr << "scan " << kCount << " ints x" << kPasses << ": iterator " << iterator_ms << " ms, for_each_segment "
+            << segment_ms << " ms" << (iterator_sum == segment_sum ? "" : " (mismatch!)") << std::endl;
+}
+
+template<typename T>
+void SegmentAlgorithmRun(const char* type_name, size_t count) {
+  Deque<T> d;
+  std::mt19937 gen(42);
+  for (size_t i = 0; i < count; ++i) {
+    d.push_back(T(gen() % 100));
+  }
+  Deque<T> copy = d;
+  const T missing = T(100);
+  size_t checksum = 0;
+
+  auto compare = [&](const char* name, auto&& segmented, auto&& iterator) {
+    int segmented_ms = MeasureMs([&] {
+      checksum += size_t(segmented());
+    });
+    int iterator_ms = MeasureMs([&] {
+      checksum += size_t(iterator());
+    });
+    std::cerr << "  " << name << ": " << segmented_ms << " ms vs " << iterator_ms << " ms" << std::endl;
+  };
+
+  std::cerr << "segment algorithms vs std over iterators, " << count << " x " << type_name << ":" << std::endl;
+  compare("find", [&] { return deque_find(d, missing); }, [&] { return std::find(d.begin(), d.end(), missing) - d.begin(); });
+  compare("count", [&] { return deque_count(d, T(7)); }, [&] { return std::count(d.begin(), d.end(), T(7)); });
+  compare("sum", [&] { return deque_sum(d); }, [&] { return std::accumulate(d.begin(), d.end(), T()); });
+  compare("min", [&] { return deque_min_element(d); },
+          [&] { return std::min_element(d.begin(), d.end()) - d.begin(); });
+  compare("max", [&] { return deque_max_element(d); },
+          [&] { return std::max_element(d.begin(), d.end()) - d.begin(); });
+  compare("equal", [&] { return deque_equal(d, copy); }, [&] { return std::equal(d.begin(), d.end(), copy.begin()); });
+  compare("lexicographical compare", [&] { return deque_lexicographical_compare(d, copy); },
+          [&] { return std::lexicographical_compare(d.begin(), d.end(), copy.begin(), copy.end()); });
+  compare("hash", [&] { return deque_hash(d); }, [&] {
+    size_t result = 0;
+    for (const T& x: d) {
+      result = result * 31 + std::hash<T>()(x);
+    }
+    return result;
+  });
+  compare("fill", [&] { deque_fill(copy, T(1)); return 0; }, [&] { std::fill(copy.begin(), copy.end(), T(1)); return 0; });
+
+  std::vector<T> sorted_values(d.begin(), d.end());
+  std::sort(sorted_values.begin(), sorted_values.end());
+  Deque<T> sorted(sorted_values.begin(), sorted_values.end());
+  std::vector<T> probes(1'000'000);
+  for (auto& probe: probes) {
+    probe = T(gen() % 100);
+  }
+  compare("lower_bound x1M", [&] {
+    size_t total = 0;
+    for (T probe: probes) {
+      total += deque_lower_bound(sorted, probe);
+    }
+    return total;
+  }, [&] {
+    size_t total = 0;
+    for (T probe: probes) {
+      total += std::lower_bound(sorted.begin(), sorted.end(), probe) - sorted.begin();
+    }
+    return total;
+  });
+  std::cerr << "  (checksum " << checksum << ")" << std::endl;
+}
+
+template<typename T>
+void TrivialCopyRun(const char* type_name, size_t count, size_t edits) {
+  Deque<T> source;
+  source.resize(count);
+  Deque<T> target;
+  target.resize(count / 2);
+  std::mt19937 gen(42);
+
+  int copy_ms = MeasureMs([&] {
+    Deque<T> copy(source);
+  });
+  int assign_ms = MeasureMs([&] {
+    target = source;
+  });
+  int insert_ms = MeasureMs([&] {
+    for (size_t i = 0; i < edits; ++i) {
+      target.insert(target.begin() + gen() % target.size(), T());
+    }
+  });
+  int erase_ms = MeasureMs([&] {
+    for (size_t i = 0; i < edits; ++i) {
+      target.erase(target.begin() + gen() % target.size());
+    }
+  });
+  int range_erase_ms = MeasureMs([&] {
+    target.erase(target.begin() + target.size() / 4, target.end() - target.size() / 4);
+  });
+  int destroy_ms = MeasureMs([&] {
+    Deque<T> doomed(std::move(source));
+  });
+
+  std::cerr << "  " << type_name << " x" << count << ": copy " << copy_ms << " ms, assign " << assign_ms
+            << " ms, " << edits << " middle inserts " << insert_ms << " ms, " << edits << " middle erases "
+            << erase_ms << " ms, range erase " << range_erase_ms << " ms, destroy " << destroy_ms << " ms"
+            << std::endl;
+}
+
+void TrivialCopyBenchmark() {
+  std::cerr << "trivially copyable elements:" << std::endl;
+  TrivialCopyRun<int>("int", 20'000'000, 200);
+  TrivialCopyRun<std::array<char, 64>>("std::array<char, 64>", 2'000'000, 200);
+}
+
+void HandOffBenchmark() {
+  const size_t kCount = 10'000'000;
+  const size_t kRounds = 1000;
+  Deque<int> stages[3];
+  stages[0].resize(kCount, 1);
+
+  int move_ms = MeasureMs([&] {
+    for (size_t round = 0; round < kRounds; ++round) {
+      stages[(round + 1) % 3] = std::move(stages[round % 3]);
+    }
+  });
+  int swap_ms = MeasureMs([&] {
+    for (size_t round = 0; round < kRounds; ++round) {
+      swap(stages[(round + 1) % 3], stages[round % 3]);
+    }
+  });
+  while (stages[0].size() == 0) {
+    swap(stages[0], stages[1]);
+    swap(stages[1], stages[2]);
+  }
+  int copy_ms = MeasureMs([&] {
+    for (size_t round = 0; round < 10; ++round) {
+      stages[(round + 1) % 3] = stages[round % 3];
+    }
+  });
+
+  std::cerr << "hand off " << kCount << "-element deques: " << kRounds << " move assignments " << move_ms << " ms, "
+            << kRounds << " swaps " << swap_ms << " ms, 10 copy assignments " << copy_ms << " ms" << std::endl;
+}
+
+template<typename Container>
+class MutexQueue {
+ private:
+  std::mutex mutex_;
+  Container queue_;
+
+ public:
+  void push_back(int value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(value);
+  }
+
+  bool try_pop_front(int& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() == 0) {
+      return false;
+    }
+    value = queue_.front();
+    queue_.pop_front();
+    return true;
+  }
+};
+
+template<typename Queue>
+void InterThreadRun(const char* name, size_t count, size_t round_trips) {
+  long long sum = 0;
+  int throughput_ms = MeasureMs([&] {
+    Queue queue;
+    std::thread consumer([&] {
+      int value = 0;
+      for (size_t i = 0; i < count; ++i) {
+        while (!queue.try_pop_front(value)) {
+          std::this_thread::yield();
+        }
+        sum += value;
+      }
+    });
+    for (size_t i = 0; i < count; ++i) {
+      queue.push_back(int(i));
+    }
+    consumer.join();
+  });
+
+  // ping-pong through two queues, half a round trip is the one-way latency
+  Queue ping;
+  Queue pong;
+  std::thread echo([&] {
+    int value = 0;
+    for (size_t i = 0; i < round_trips; ++i) {
+      while (!ping.try_pop_front(value)) {
+        std::this_thread::yield();
+      }
+      pong.push_back(value);
+    }
+  });
+  auto start = std::chrono::steady_clock::now();
+  int value = 0;
+  for (size_t i = 0; i < round_trips; ++i) {
+    ping.push_back(int(i));
+    while (!pong.try_pop_front(value)) {
+      std::this_thread::yield();
+    }
+  }
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  echo.join();
+
+  std::cerr << name << ": " << count << " ints in " << throughput_ms << " ms ("
+            << (throughput_ms > 0 ? count / 1000 / throughput_ms : 0) << " M/s), one-way latency "
+            << ns / 2 / round_trips << " ns (checksum " << sum << ")" << std::endl;
+}
+
+void InterThreadBenchmark() {
+  const size_t kCount = 20'000'000;
+  const size_t kRoundTrips = 200'000;
+  InterThreadRun<SpscDeque<int>>("SpscDeque", kCount, kRoundTrips);
+  InterThreadRun<MutexQueue<Deque<int>>>("mutex + Deque", kCount, kRoundTrips);
+  InterThreadRun<MutexQueue<std::deque<int>>>("mutex + std::deque", kCount, kRoundTrips);
+}
+
+// 1, 2, 4, ... and finally every core
+std::vector<size_t> ThreadCounts() {
+  size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<size_t> counts;
+  for (size_t threads = 1; threads < cores; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(cores);
+  return counts;
+}
+
+long long SerialFib(int n) {
+  return n < 2 ? n : SerialFib(n - 1) + SerialFib(n - 2);
+}
+
+// fork-join fib: the second half of each split goes on the worker's deque, and a worker waiting
+// for a stolen child keeps running its own and other workers' tasks
+class ForkJoinFib {
+ private:
+  struct Task {
+    int n;
+    long long result = 0;
+    std::atomic<bool> done{false};
+
+    explicit Task(int n) : n(n) {}
+  };
+
+  const int cutoff_;
+  std::vector<std::unique_ptr<WorkStealingDeque<Task*>>> deques_;
+  std::atomic<bool> finished_{false};
+
+  bool run_other(size_t self, std::mt19937& gen) {
+    if (auto task = deques_[self]->pop()) {
+      run(**task, self, gen);
+      return true;
+    }
+    size_t victim = gen() % deques_.size();
+    if (victim != self) {
+      if (auto task = deques_[victim]->steal()) {
+        run(**task, self, gen);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(Task& task, size_t self, std::mt19937& gen) {
+    if (task.n < cutoff_) {
+      task.result = SerialFib(task.n);
+    } else {
+      Task child(task.n - 1);
+      deques_[self]->push(&child);
+      Task other(task.n - 2);
+      run(other, self, gen);
+      while (!child.done.load(std::memory_order_acquire)) {
+        if (!run_other(self, gen)) {
+          std::this_thread::yield();
+        }
+      }
+      task.result = child.result + other.result;
+    }
+    task.done.store(true, std::memory_order_release);
+  }
+
+ public:
+  ForkJoinFib(size_t threads, int cutoff) : cutoff_(cutoff) {
+    for (size_t i = 0; i < threads; ++i) {
+      deques_.push_back(std::make_unique<WorkStealingDeque<Task*>>());
+    }
+  }
+
+  long long compute(int n) {
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < deques_.size(); ++i) {
+      workers.emplace_back([this, i] {
+        std::mt19937 gen(i);
+        while (!finished_.load(std::memory_order_acquire)) {
+          if (!run_other(i, gen)) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    std::mt19937 gen(0);
+    Task root(n);
+    run(root, 0, gen);
+    finished_.store(true, std::memory_order_release);
+    for (auto& worker: workers) {
+      worker.join();
+    }
+    return root.result;
+  }
+};
+
+void ForkJoinBenchmark() {
+  const int kN = 38;
+  const int kCutoff = 18;
+  long long expected = 0;
+  int serial_ms = MeasureMs([&] { expected = SerialFib(kN); });
+  std::cerr << "fib(" << kN << ") serial: " << serial_ms << " ms" << std::endl;
+
+  for (size_t threads: ThreadCounts()) {
+    long long result = 0;
+    int ms = MeasureMs([&] { result = ForkJoinFib(threads, kCutoff).compute(kN); });
+    std::cerr << "fib(" << kN << ") fork-join on " << threads << " threads: " << ms << " ms"
+              << (result == expected ? "" : " WRONG RESULT") << std::endl;
+  }
+}
+
+size_t CollatzSteps(size_t n) {
+  size_t steps = 0;
+  for (; n != 1; ++steps) {
+    n = (n % 2 == 0) ? n / 2 : 3 * n + 1;
+  }
+  return steps;
+}
+
+void ThreadPoolBenchmark() {
+  const size_t kCount = 3'000'000;
+  const size_t kGrain = 4096;
+  size_t expected = 0;
+  int serial_ms = MeasureMs([&] {
+    for (size_t i = 1; i <= kCount; ++i) {
+      expected += CollatzSteps(i);
+    }
+  });
+  std::cerr << "collatz steps up to " << kCount << " serial: " << serial_ms << " ms" << std::endl;
+
+  for (size_t threads: ThreadCounts()) {
+    ThreadPool pool(threads);
+    std::atomic<size_t> total{0};
+    int ms = MeasureMs([&] {
+      pool.parallel_for(1, kCount + 1, kGrain, [&](size_t first, size_t last) {
+        size_t local = 0;
+        for (size_t i = first; i < last; ++i) {
+          local += CollatzSteps(i);
+        }
+        total.fetch_add(local, std::memory_order_relaxed);
+      });
+    });
+    int submit_ms = MeasureMs([&] {
+      std::vector<std::future<size_t>> futures;
+      for (size_t first = 1; first <= kCount; first += kGrain) {
+        futures.push_back(pool.submit([first, kCount, kGrain] {
+          size_t local = 0;
+          for (size_t i = first; i < std::min(first + kGrain, kCount + 1); ++i) {
+            local += CollatzSteps(i);
+          }
+          return local;
+        }));
+      }
+      for (auto& future: futures) {
+        future.get();
+      }
+    });
+    std::cerr << "  " << threads << " threads: parallel_for " << ms << " ms, submit + future " << submit_ms << " ms"
+              << (total.load() == expected ? "" : " WRONG RESULT") << std::endl;
+  }
+}
+
+void ParallelSegmentBenchmark() {
+  const int kCount = 50'000'000;
+  int fill_ms = MeasureMs([&] { Deque<int> d(kCount, 1); });
+  Deque<int> source(kCount, 1);
+  int copy_ms = MeasureMs([&] { Deque<int> d(source); });
+  int transform_ms = MeasureMs([&] {
+    source.for_each_segment([](std::span<int> segment) {
+      std::transform(segment.begin(), segment.end(), segment.begin(), [](int x) { return x * 3 + 1; });
+    });
+  });
+  std::cerr << kCount << " ints serial: fill construct " << fill_ms << " ms, copy construct " << copy_ms
+            << " ms, transform " << transform_ms << " ms" << std::endl;
+
+  for (size_t threads: ThreadCounts()) {
+    ThreadPool pool(threads);
+    int parallel_fill_ms = MeasureMs([&] {
+      Deque<int> d;
+      deque_parallel_append_fill(pool, d, kCount, 1);
+    });
+    int parallel_copy_ms = MeasureMs([&] {
+      Deque<int> d;
+      deque_parallel_append_copy(pool, d, source);
+    });
+    int parallel_transform_ms = MeasureMs([&] {
+      deque_parallel_transform(pool, source, source, [](int x) { return x * 3 + 1; });
+    });
+    int for_each_ms = MeasureMs([&] {
+      deque_parallel_for_each(pool, source, [](int& x) { x ^= 0x5a5a; });
+    });
+    std::cerr << "  " << threads << " threads: fill construct " << parallel_fill_ms << " ms, copy construct "
+              << parallel_copy_ms << " ms, transform " << parallel_transform_ms << " ms, for_each " << for_each_ms
+              << " ms" << std::endl;
+  }
+}
+
+struct SortRecord {
+  uint64_t key;
+  uint64_t payload;
+
+  bool operator<(const SortRecord& other) const {
+    return key < other.key;
+  }
+};
+
+template<typename T>
+void SortRun(const char* type_name, size_t count) {
+  std::mt19937_64 gen(7);
+  std::vector<T> values(count);
+  for (auto& value: values) {
+    if constexpr (std::is_same_v<T, SortRecord>) {
+      value = SortRecord{gen(), 0};
+    } else {
+      value = T(gen());
+    }
+  }
+  int vector_ms = 0;
+  {
+    std::vector<T> v(values);
+    vector_ms = MeasureMs([&] { std::sort(v.begin(), v.end()); });
+  }
+  int std_deque_ms = 0;
+  {
+    std::deque<T> d(values.begin(), values.end());
+    std_deque_ms = MeasureMs([&] { std::sort(d.begin(), d.end()); });
+  }
+  int iterator_ms = 0;
+  {
+    Deque<T> d(values.begin(), values.end());
+    iterator_ms = MeasureMs([&] { std::sort(d.begin(), d.end()); });
+  }
+  int member_ms = 0;
+  {
+    Deque<T> d(values.begin(), values.end());
+    member_ms = MeasureMs([&] { d.sort(); });
+  }
+  std::cerr << count << " " << type_name << ": std::sort on std::vector " << vector_ms << " ms, on std::deque "
+            << std_deque_ms << " ms, on Deque iterators " << iterator_ms << " ms, Deque::sort " << member_ms << " ms"
+            << std::endl;
+  for (size_t threads: ThreadCounts()) {
+    ThreadPool pool(threads);
+    Deque<T> d(values.begin(), values.end());
+    int parallel_ms = MeasureMs([&] { deque_parallel_sort(pool, d); });
+    std::cerr << "  deque_parallel_sort on " << threads << " threads: " << parallel_ms << " ms" << std::endl;
+  }
+}
+
+// keeps the last kWindow samples of a stream and sums the window every kReadout samples
+void TelemetryWindowBenchmark() {
+  const size_t kSamples = 200'000'000;
+  const size_t kWindow = 4096;
+  const size_t kReadout = 1'000'000;
+  long long checksum = 0;
+
+  int deque_ms = MeasureMs([&] {
+    Deque<int> window;
+    for (size_t i = 0; i < kSamples; ++i) {
+      window.push_back(int(i));
+      if (window.size() > kWindow) {
+        window.pop_front();
+      }
+      if (i % kReadout == 0) {
+        window.for_each_segment([&](std::span<const int> piece) {
+          checksum += std::accumulate(piece.begin(), piece.end(), 0LL);
+        });
+      }
+    }
+  });
+  int std_deque_ms = MeasureMs([&] {
+    std::deque<int> window;
+    for (size_t i = 0; i < kSamples; ++i) {
+      window.push_back(int(i));
+      if (window.size() > kWindow) {
+        window.pop_front();
+      }
+      if (i % kReadout == 0) {
+        checksum += std::accumulate(window.begin(), window.end(), 0LL);
+      }
+    }
+  });
+  int ring_ms = MeasureMs([&] {
+    RingBuffer<int> window(kWindow);
+    for (size_t i = 0; i < kSamples; ++i) {
+      window.push_back(int(i));
+      if (i % kReadout == 0) {
+        for (auto piece: window.segments()) {
+          checksum += std::accumulate(piece.begin(), piece.end(), 0LL);
+        }
+      }
+    }
+  });
+
+  std::cerr << "telemetry window of " << kWindow << " over " << kSamples << " samples: Deque " << deque_ms
+            << " ms, std::deque " << std_deque_ms << " ms, RingBuffer " << ring_ms << " ms (checksum "
+            << checksum % 1000 << ")" << std::endl;
+}
+
+// per-operation latencies in power-of-two nanosecond buckets
+struct LatencyHistogram {
+  std::array<size_t, 64> buckets{};
+  size_t count = 0;
+
+  void add(long long ns) {
+    size_t bucket = 0;
+    while (bucket + 1 < buckets.size() && (1LL << (bucket + 1)) <= ns) {
+      ++bucket;
+    }
+    ++buckets[bucket];
+    ++count;
+  }
+
+  // upper bound of the bucket holding the given fraction of operations
+  long long percentile_ns(double fraction) const {
+    size_t seen = 0;
+    for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+      seen += buckets[bucket];
+      if (double(seen) >= fraction * double(count)) {
+        return 1LL << (bucket + 1);
+      }
+    }
+    return 1LL << buckets.size();
+  }
+};
+
+// bursts into a fresh deque with the burst size either reserved up front or not;
+// reports the tail of the push latencies and the allocator calls made inside the bursts
+void ReserveBurstRun(bool reserve) {
+  using namespace std::chrono;
+  const size_t kBursts = 20;
+  const size_t kBurst = 4'000'000;
+
+  LatencyHistogram histogram;
+  size_t calls = 0;
+  for (size_t burst = 0; burst < kBursts; ++burst) {
+    Deque<int, CountingAllocator<int>> d;
+    if (reserve) {
+      d.reserve_back(kBurst);
+    }
+    size_t calls_before = CountingAllocator<int>::calls + CountingAllocator<int*>::calls;
+    for (size_t i = 0; i < kBurst; ++i) {
+      auto start = steady_clock::now();
+      d.push_back(int(i));
+      histogram.add(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    }
+    calls += CountingAllocator<int>::calls + CountingAllocator<int*>::calls - calls_before;
+  }
+  std::cerr << "  " << (reserve ? "reserve_back first" : "no reserve        ") << ": p99.9 < "
+            << histogram.percentile_ns(0.999) << " ns, p99.99 < " << histogram.percentile_ns(0.9999)
+            << " ns, p99.999 < " << histogram.percentile_ns(0.99999) << " ns, " << calls
+            << " allocator calls inside the bursts" << std::endl;
+}
+
+void ReserveBurstBenchmark() {
+  std::cerr << "20 bursts of 4M push_back into a fresh deque:" << std::endl;
+  ReserveBurstRun(false);
+  ReserveBurstRun(true);
+}
+
+// push_back latencies of one deque growing from empty, with the map grown in one go or incrementally
+void GrowthLatencyRun(bool incremental, size_t count) {
+  using namespace std::chrono;
+  LatencyHistogram histogram;
+  long long worst_ns = 0;
+  Deque<int, std::allocator<int>, FixedChunkPolicy<16>> d;
+  d.set_incremental_growth(incremental);
+  for (size_t i = 0; i < count; ++i) {
+    auto start = steady_clock::now();
+    d.push_back(int(i));
+    long long ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    histogram.add(ns);
+    worst_ns = std::max(worst_ns, ns);
+  }
+  std::cerr << "  " << (incremental ? "incremental" : "in one go  ") << ": p99.9 < "
+            << histogram.percentile_ns(0.999) << " ns, p99.99 < " << histogram.percentile_ns(0.9999)
+            << " ns, p99.999 < " << histogram.percentile_ns(0.99999) << " ns, p99.9999 < "
+            << histogram.percentile_ns(0.999999) << " ns, worst " << worst_ns / 1000
+            << " us" << std::endl;
+}
+
+void GrowthLatencyBenchmark() {
+  const size_t kCount = 200'000'000;
+  std::cerr << kCount << " push_back into 16-element chunks, map growth:" << std::endl;
+  GrowthLatencyRun(false, kCount);
+  // the first run frees millions of small chunks, which glibc would otherwise merge inside some later push
+  malloc_trim(0);
+  GrowthLatencyRun(true, kCount);
+}
+
+// one short-lived deque per request, filled with a few hundred ints and dropped
+void PerRequestPoolBenchmark() {
+  const size_t kRequests = 2'000'000;
+  const size_t kElements = 300;
+  long long checksum = 0;
+  auto serve = [&](auto& d) {
+    for (size_t i = 0; i < kElements; ++i) {
+      d.push_back(int(i));
+    }
+    checksum += d[kElements / 2];
+  };
+
+  CountingAllocator<int>::calls = 0;
+  CountingAllocator<int*>::calls = 0;
+  int plain_ms = MeasureMs([&] {
+    for (size_t request = 0; request < kRequests; ++request) {
+      Deque<int, CountingAllocator<int>> d;
+      serve(d);
+    }
+  });
+  size_t plain_calls = CountingAllocator<int>::calls + CountingAllocator<int*>::calls;
+
+  ChunkPoolStats before = ChunkPool::stats();
+  int pooled_ms = MeasureMs([&] {
+    for (size_t request = 0; request < kRequests; ++request) {
+      PooledDeque<int> d;
+      serve(d);
+    }
+  });
+  ChunkPoolStats after = ChunkPool::stats();
+  size_t pooled_calls = after.system_allocations - before.system_allocations + after.system_deallocations -
+                        before.system_deallocations;
+
+  int std_deque_ms = MeasureMs([&] {
+    for (size_t request = 0; request < kRequests; ++request) {
+      std::deque<int> d;
+      serve(d);
+    }
+  });
+
+  std::cerr << kRequests << " requests of a " << kElements << "-int deque: Deque " << plain_ms << " ms with "
+            << plain_calls << " malloc/free calls, PooledDeque " << pooled_ms << " ms with " << pooled_calls
+            << ", std::deque " << std_deque_ms << " ms (checksum " << checksum % 1000 << ")" << std::endl;
+}
+
+// one deque per request that never outgrows a few dozen elements
+void SmallRequestBenchmark() {
+  const size_t kRequests = 10'000'000;
+  const size_t kElements = 24;
+  long long checksum = 0;
+  auto serve = [&](auto& d, size_t request) {
+    for (size_t i = 0; i < kElements / 2; ++i) {
+      d.push_back(int(request + i));
+      d.push_front(int(i));
+    }
+    d.pop_front();
+    checksum += d[kElements / 2] + d.back();
+  };
+
+  CountingAllocator<int>::calls = 0;
+  CountingAllocator<int*>::calls = 0;
+  int small_ms = MeasureMs([&] {
+    for (size_t request = 0; request < kRequests; ++request) {
+      SmallDeque<int, 32, CountingAllocator<int>> d;
+      serve(d, request);
+    }
+  });
+  size_t small_calls = CountingAllocator<int>::calls + CountingAllocator<int*>::calls;
+
+  CountingAllocator<int>::calls = 0;
+  CountingAllocator<int*>::calls = 0;
+  int plain_ms = MeasureMs([&] {
+    for (size_t request = 0; request < kRequests; ++request) {
+      Deque<int, CountingAllocator<int>> d;
+      serve(d, request);
+    }
+  });
+  size_t plain_calls = CountingAllocator<int>::calls + CountingAllocator<int*>::calls;
+
+  int std_deque_ms = MeasureMs([&] {
+    for (size_t request = 0; request < kRequests; ++request) {
+      std::deque<int> d;
+      serve(d, request);
+    }
+  });
+
+  std::cerr << kRequests << " requests of a " << kElements << "-int deque: SmallDeque<int, 32> " << small_ms
+            << " ms with " << small_calls << " malloc/free calls, Deque " << plain_ms << " ms with " << plain_calls
+            << ", std::deque " << std_deque_ms << " ms (checksum " << checksum % 1000 << ")" << std::endl;
+}
+
+// a 64-element sliding window in a hot loop; the same template body runs on each container
+template<typename Window>
+long long SlidingWindowRun(Window& window, size_t steps) {
+  long long checksum = 0;
+  for (size_t step = 0; step < steps; ++step) {
+    if (window.size() == 64) {
+      window.pop_front();
+    }
+    window.push_back(int(step));
+    checksum += window.front() + window[window.size() / 2];
+  }
+  return checksum;
+}
+
+void StaticWindowBenchmark() {
+  const size_t kSteps = 200'000'000;
+  long long checksum = 0;
+  int static_ms = MeasureMs([&] {
+    StaticDeque<int, 64> window;
+    checksum += SlidingWindowRun(window, kSteps);
+  });
+  int deque_ms = MeasureMs([&] {
+    Deque<int> window;
+    checksum += SlidingWindowRun(window, kSteps);
+  });
+  int std_deque_ms = MeasureMs([&] {
+    std::deque<int> window;
+    checksum += SlidingWindowRun(window, kSteps);
+  });
+  std::cerr << kSteps << " steps of a 64-int sliding window: StaticDeque " << static_ms << " ms, Deque " << deque_ms
+            << " ms, std::deque " << std_deque_ms << " ms (checksum " << checksum % 1000 << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  auto enabled = [&](const char* name) {
+    return argc < 2 || std::strcmp(argv[1], name) == 0;
+  };
+
+  if (enabled("enqueue")) {
+    EnqueueBenchmark();
+  }
+  if (enabled("insert")) {
+    RandomInsertBenchmark();
+  }
+  if (enabled("chunk")) {
+    ChunkPolicyBenchmark<char>("char", 20'000'000);
+    ChunkPolicyBenchmark<int>("int", 20'000'000);
+    ChunkPolicyBenchmark<Record256>("256-byte struct", 1'000'000);
+  }
+  if (enabled("access")) {
+    RandomAccessBenchmark();
+  }
+  if (enabled("memory")) {
+    MemoryBenchmark();
+  }
+  if (enabled("cache")) {
+    OrderQueueBenchmark();
+  }
+  if (enabled("bulk")) {
+    BulkLoadBenchmark();
+  }
+  if (enabled("scan")) {
+    SegmentScanBenchmark();
+  }
+  if (enabled("algorithm")) {
+    SegmentAlgorithmRun<int>("int", 50'000'000);
+    SegmentAlgorithmRun<int8_t>("int8_t", 50'000'000);
+    SegmentAlgorithmRun<double>("double", 20'000'000);
+  }
+  if (enabled("trivial")) {
+    TrivialCopyBenchmark();
+  }
+  if (enabled("handoff")) {
+    HandOffBenchmark();
+  }
+  if (enabled("spsc")) {
+    InterThreadBenchmark();
+  }
+  if (enabled("forkjoin")) {
+    ForkJoinBenchmark();
+  }
+  if (enabled("pool")) {
+    ThreadPoolBenchmark();
+  }
+  if (enabled("parallel")) {
+    ParallelSegmentBenchmark();
+  }
+  if (enabled("sort")) {
+    SortRun<int>("int", 100'000'000);
+    SortRun<SortRecord>("16-byte records", 30'000'000);
+  }
+  if (enabled("ring")) {
+    TelemetryWindowBenchmark();
+  }
+  if (enabled("reserve")) {
+    ReserveBurstBenchmark();
+  }
+  if (enabled("growth")) {
+    GrowthLatencyBenchmark();
+  }
+  if (enabled("chunkpool")) {
+    PerRequestPoolBenchmark();
+  }
+  if (enabled("small")) {
+    SmallRequestBenchmark();
+  }
+  if (enabled("static")) {
+    StaticWindowBenchmark();
+  }
+  if (enabled("soak")) {
+    FifoSoakBenchmark(1'000'000'000);
+  }
+
+  return 0;
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "deque.h"
+
+// how many freed blocks of one byte size are kept before they move on
+struct ChunkPoolLimits {
+  size_t thread_blocks = 256;  // in each thread's cache; past it half of them go to the global layer
+  size_t global_blocks = 4096; // in the global layer; past it they go back to operator delete
+};
+
+struct ChunkPoolStats {
+  size_t system_allocations = 0;
+  size_t system_deallocations = 0;
+};
+
+// process-wide cache of freed blocks keyed by byte size. every thread serves itself from a cache of its own
+// and trades batches with a mutex-guarded global layer, so the chunks and maps one Deque frees are what the
+// next one gets, with no malloc in between. blocks above MAX_POOLED_BYTES_ bypass the pool
+class ChunkPool {
+ private:
+  static constexpr size_t MAX_POOLED_BYTES_ = 64 * 1024;
+
+  struct Bin {
+    size_t bytes;
+    std::vector<void*> blocks;
+  };
+
+  struct ThreadCache {
+    std::vector<Bin> bins;
+
+    ~ThreadCache() noexcept;
+  };
+
+  struct Global {
+    std::mutex mutex;
+    std::vector<Bin> bins;
+    size_t limit = ChunkPoolLimits().global_blocks;
+  };
+
+  static inline std::atomic<size_t> thread_limit_{ChunkPoolLimits().thread_blocks};
+  static inline std::atomic<size_t> system_allocations_{0};
+  static inline std::atomic<size_t> system_deallocations_{0};
+  // set once the calling thread's cache is gone, late frees then go straight to the system
+  static inline thread_local bool cache_destroyed_ = false;
+
+  static Global& global() noexcept;
+  static ThreadCache* thread_cache() noexcept;
+  static Bin& find_bin(std::vector<Bin>&, size_t);
+  static void* system_allocate(size_t);
+  static void system_deallocate(void*, size_t) noexcept;
+  static void refill(Bin&);
+  static void give_back(Bin&, size_t keep) noexcept;
+
+ public:
+  static void* allocate(size_t);
+  static void deallocate(void*, size_t) noexcept;
+
+  static ChunkPoolLimits limits() noexcept;
+  static void set_limits(const ChunkPoolLimits&);
+  // hands this thread's cache to the global layer and frees everything the global layer holds;
+  // the caches of other threads stay as they are
+  static void trim() noexcept;
+  static ChunkPoolStats stats() noexcept;
+};
+
+// the global layer outlives every thread_local cache, so it is never destroyed
+inline ChunkPool::Global& ChunkPool::global() noexcept {
+  static Global* layer = new Global();
+  return *layer;
+}
+
+inline ChunkPool::ThreadCache* ChunkPool::thread_cache() noexcept {
+  if (cache_destroyed_) {
+    return nullptr;
+  }
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+inline ChunkPool::ThreadCache::~ThreadCache() noexcept {
+  for (Bin& bin: bins) {
+    give_back(bin, 0);
+  }
+  cache_destroyed_ = true;
+}
+
+// a handful of distinct sizes at most, so a linear search with the last hit in front
+inline ChunkPool::Bin& ChunkPool::find_bin(std::vector<Bin>& bins, size_t bytes) {
+  for (size_t i = 0; i < bins.size(); ++i) {
+    if (bins[i].bytes == bytes) {
+      if (i > 0) {
+        std::swap(bins[i], bins[0]);
+      }
+      return bins[0];
+    }
+  }
+  bins.push_back(Bin{bytes, {}});
+  std::swap(bins.back(), bins[0]);
+  return bins[0];
+}
+
+inline void* ChunkPool::system_allocate(size_t bytes) {
+  void* block = ::operator new(bytes);
+  system_allocations_.fetch_add(1, std::memory_order_relaxed);
+  return block;
+}
+
+inline void ChunkPool::system_deallocate(void* block, size_t bytes) noexcept {
+  ::operator delete(block, bytes);
+  system_deallocations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// takes up to half a thread cache worth of blocks from the global layer
+inline void ChunkPool::refill(Bin& bin) {
+  Global& layer = global();
+  std::lock_guard<std::mutex> lock(layer.mutex);
+  Bin& source = find_bin(layer.bins, bin.bytes);
+  size_t count = std::min(source.blocks.size(), std::max<size_t>(thread_limit_.load(std::memory_order_relaxed) / 2, 1));
+  bin.blocks.insert(bin.blocks.end(), source.blocks.end() - count, source.blocks.end());
+  source.blocks.resize(source.blocks.size() - count);
+}
+
+// moves the blocks of bin past the first keep to the global layer, or to the system once that is full
+inline void ChunkPool::give_back(Bin& bin, size_t keep) noexcept {
+  if (bin.blocks.size() <= keep) {
+    return;
+  }
+  Global& layer = global();
+  std::lock_guard<std::mutex> lock(layer.mutex);
+  try {
+    Bin& target = find_bin(layer.bins, bin.bytes);
+    size_t room = layer.limit > target.blocks.size() ? layer.limit - target.blocks.size() : 0;
+    size_t count = std::min(room, bin.blocks.size() - keep);
+    target.blocks.insert(target.blocks.end(), bin.blocks.end() - count, bin.blocks.end());
+    bin.blocks.resize(bin.blocks.size() - count);
+  } catch (...) {
+    // no room to record them, they go to the system below
+  }
+  for (size_t i = keep; i < bin.blocks.size(); ++i) {
+    system_deallocate(bin.blocks[i], bin.bytes);
+  }
+  bin.blocks.resize(keep);
+}
+
+inline void* ChunkPool::allocate(size_t bytes) {
+  ThreadCache* cache = thread_cache();
+  if (bytes == 0 || bytes > MAX_POOLED_BYTES_ || cache == nullptr) {
+    return system_allocate(bytes);
+  }
+  Bin& bin = find_bin(cache->bins, bytes);
+  if (bin.blocks.empty()) {
+    refill(bin);
+    if (bin.blocks.empty()) {
+      return system_allocate(bytes);
+    }
+  }
+  void* block = bin.blocks.back();
+  bin.blocks.pop_back();
+  return block;
+}
+
+inline void ChunkPool::deallocate(void* block, size_t bytes) noexcept {
+  if (block == nullptr) {
+    return;
+  }
+  ThreadCache* cache = thread_cache();
+  if (bytes == 0 || bytes > MAX_POOLED_BYTES_ || cache == nullptr) {
+    system_deallocate(block, bytes);
+    return;
+  }
+  try {
+    Bin& bin = find_bin(cache->bins, bytes);
+    bin.blocks.push_back(block);
+    size_t limit = thread_limit_.load(std::memory_order_relaxed);
+    if (bin.blocks.size() > limit) {
+      give_back(bin, limit / 2);
+    }
+  } catch (...) {
+    system_deallocate(block, bytes);
+  }
+}
+
+inline ChunkPoolLimits ChunkPool::limits() noexcept {
+  Global& layer = global();
+  std::lock_guard<std::mutex> lock(layer.mutex);
+  return ChunkPoolLimits{thread_limit_.load(std::memory_order_relaxed), layer.limit};
+}
+
+inline void ChunkPool::set_limits(const ChunkPoolLimits& limits) {
+  Global& layer = global();
+  std::lock_guard<std::mutex> lock(layer.mutex);
+  thread_limit_.store(limits.thread_blocks, std::memory_order_relaxed);
+  layer.limit = limits.global_blocks;
+}
+
+inline void ChunkPool::trim() noexcept {
+  if (ThreadCache* cache = thread_cache()) {
+    for (Bin& bin: cache->bins) {
+      give_back(bin, 0);
+    }
+  }
+  Global& layer = global();
+  std::lock_guard<std::mutex> lock(layer.mutex);
+  for (Bin& bin: layer.bins) {
+    for (void* block: bin.blocks) {
+      system_deallocate(block, bin.bytes);
+    }
+    bin.blocks.clear();
+  }
+}
+
+inline ChunkPoolStats ChunkPool::stats() noexcept {
+  return ChunkPoolStats{system_allocations_.load(std::memory_order_relaxed),
+                        system_deallocations_.load(std::memory_order_relaxed)};
+}
+
+// stateless allocator over ChunkPool; Deque<T, ChunkPoolAllocator<T>> takes its chunks and its map from the pool
+template<typename T>
+class ChunkPoolAllocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  template<typename U>
+  struct rebind {
+    using other = ChunkPoolAllocator<U>;
+  };
+
+  ChunkPoolAllocator() noexcept = default;
+  template<typename U>
+  ChunkPoolAllocator(const ChunkPoolAllocator<U>&) noexcept;
+
+  bool operator==(const ChunkPoolAllocator<T>&) const noexcept;
+  bool operator!=(const ChunkPoolAllocator<T>&) const noexcept;
+
+  T* allocate(size_t);
+  void deallocate(T*, size_t) noexcept;
+};
+
+template<typename T>
+template<typename U>
+ChunkPoolAllocator<T>::ChunkPoolAllocator(const ChunkPoolAllocator<U>&) noexcept {}
+
+template<typename T>
+bool ChunkPoolAllocator<T>::operator==(const ChunkPoolAllocator<T>&) const noexcept {
+  return true;
+}
+
+template<typename T>
+bool ChunkPoolAllocator<T>::operator!=(const ChunkPoolAllocator<T>&) const noexcept {
+  return false;
+}
+
+// the pool hands out operator new alignment, over-aligned types go around it
+template<typename T>
+T* ChunkPoolAllocator<T>::allocate(size_t count) {
+  if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    return std::allocator<T>().allocate(count);
+  } else {
+    if (count > size_t(-1) / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(ChunkPool::allocate(count * sizeof(T)));
+  }
+}
+
+template<typename T>
+void ChunkPoolAllocator<T>::deallocate(T* pointer, size_t count) noexcept {
+  if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    std::allocator<T>().deallocate(pointer, count);
+  } else {
+    ChunkPool::deallocate(pointer, count * sizeof(T));
+  }
+}
+
+template<typename T, typename ChunkPolicy = SmallChunkPolicy>
+using PooledDeque = Deque<T, ChunkPoolAllocator<T>, ChunkPolicy>;
@@ -0,0 +1,132 @@
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chunk_pool.h"
+
+struct alignas(64) Wide {
+  int x = 0;
+
+  Wide(int x) : x(x) {}
+};
+
+void test1() {
+  ChunkPool::trim();
+  // the first request warms the pool up, the ones after it never reach the system
+  size_t before = 0;
+  for (int request = 0; request < 1000; ++request) {
+    if (request == 1) {
+      before = ChunkPool::stats().system_allocations;
+    }
+    PooledDeque<int> d;
+    for (int i = 0; i < 500; ++i) {
+      d.push_back(i);
+      d.push_front(-i);
+    }
+    assert(d.size() == 1000 && d.front() == -499 && d.back() == 499);
+    PooledDeque<std::string> words;
+    words.push_back(std::string(50, 'w'));
+    PooledDeque<int> copy(d);
+    assert(copy[999] == 499);
+  }
+  assert(ChunkPool::stats().system_allocations == before);
+
+  // maps past the pooled size and over-aligned chunks go around the pool
+  {
+    PooledDeque<int, FixedChunkPolicy<1>> long_map;
+    for (int i = 0; i < 100'000; ++i) {
+      long_map.push_back(i);
+    }
+    assert(long_map[99'999] == 99'999);
+    Deque<Wide, ChunkPoolAllocator<Wide>> wide;
+    for (int i = 0; i < 100; ++i) {
+      wide.emplace_back(i);
+    }
+    assert(wide[99].x == 99 && reinterpret_cast<uintptr_t>(&wide[99]) % 64 == 0);
+  }
+
+  ChunkPoolAllocator<int> a;
+  ChunkPoolAllocator<double> b(a);
+  assert(a == ChunkPoolAllocator<int>(b) && !(a != ChunkPoolAllocator<int>(b)));
+  int* block = a.allocate(3);
+  block[2] = 7;
+  a.deallocate(block, 3);
+  assert(a.allocate(3) == block);
+  a.deallocate(block, 3);
+}
+
+void test2() {
+  ChunkPoolLimits limits = ChunkPool::limits();
+  ChunkPool::set_limits(ChunkPoolLimits{8, 16});
+  assert(ChunkPool::limits().thread_blocks == 8 && ChunkPool::limits().global_blocks == 16);
+  ChunkPool::trim();
+
+  // past both marks the blocks go back to the system as they are freed
+  ChunkPoolStats before = ChunkPool::stats();
+  {
+    std::vector<PooledDeque<int, FixedChunkPolicy<4>>> many(10);
+    for (auto& d: many) {
+      for (int i = 0; i < 100; ++i) {
+        d.push_back(i);
+      }
+    }
+  }
+  ChunkPoolStats after = ChunkPool::stats();
+  size_t cached = (after.system_allocations - before.system_allocations) -
+                  (after.system_deallocations - before.system_deallocations);
+  assert(cached <= 8 + 16 + 8 + 16);
+  ChunkPool::trim();
+  after = ChunkPool::stats();
+  assert(after.system_allocations - before.system_allocations ==
+         after.system_deallocations - before.system_deallocations);
+  ChunkPool::set_limits(limits);
+}
+
+void test3() {
+  // deques built on one thread and destroyed on another, and threads that exit with a full cache
+  std::vector<PooledDeque<size_t>> handed_over(8);
+  std::vector<std::thread> threads;
+  std::atomic<size_t> sum{0};
+  for (size_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t round = 0; round < 200; ++round) {
+        PooledDeque<size_t> d;
+        for (size_t i = 0; i < 300; ++i) {
+          d.push_back(i);
+        }
+        sum.fetch_add(d[299], std::memory_order_relaxed);
+      }
+      for (size_t i = 0; i < 1000; ++i) {
+        handed_over[t].push_back(t * 1000 + i);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  assert(sum.load() == 8 * 200 * 299);
+  for (size_t t = 0; t < 8; ++t) {
+    assert(handed_over[t].size() == 1000 && handed_over[t][999] == t * 1000 + 999);
+  }
+  handed_over.clear();
+  ChunkPool::trim();
+  ChunkPoolStats stats = ChunkPool::stats();
+  assert(stats.system_allocations == stats.system_deallocations);
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Test 2 passed.\n";
+
+  test3();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -1,45 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// picks the number of elements per chunk from a byte target, rounded down to a power of two
+template<size_t ChunkBytes>
+struct ChunkSizePolicy {
+  static_assert(ChunkBytes > 0, "chunk byte target must be positive");
+
+  template<typename T>
+  static constexpr size_t chunk_size() noexcept {
+    size_t count = (ChunkBytes / sizeof(T) > 0) ? ChunkBytes / sizeof(T) : 1;
+    size_t power = 1;
+    while (power * 2 <= count) {
+      power *= 2;
+    }
+    return power;
+  }
+};
+
+// the same number of elements per chunk for every T
+template<size_t Count>
+struct FixedChunkPolicy {
+  static_assert(Count > 0 && (Count & (Count - 1)) == 0, "chunk size must be a power of two");
+
+  template<typename T>
+  static constexpr size_t chunk_size() noexcept {
+    return Count;
+  }
+};
 
-template<typename T>
+using SmallChunkPolicy = ChunkSizePolicy<512>;
+using PageChunkPolicy = ChunkSizePolicy<4096>;
+
+constexpr size_t chunk_shift(size_t chunk_size) noexcept {
+  size_t shift = 0;
+  while ((size_t(1) << shift) < chunk_size) {
+    ++shift;
+  }
+  return shift;
+}
+
+template<typename T, typename Allocator = std::allocator<T>, typename ChunkPolicy = SmallChunkPolicy>
 class Deque {
  private:
+  using chunk_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  using map_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<T*>;
+  using AllocTraits = std::allocator_traits<chunk_allocator_type>;
+  using MapAllocTraits = std::allocator_traits<map_allocator_type>;
+
+  chunk_allocator_type allocator_;
+  map_allocator_type map_allocator_;
   T** deque_;
   size_t size_ = 0;
+  size_t offset_ = 0; // index of the first element counted from the start of deque_[0]
   size_t array_count_ = START_ARRAY_COUNT_;
+  size_t growth_factor_ = 2;
+  bool incremental_growth_ = false;
   static const size_t START_ARRAY_COUNT_;
-  static const size_t MAX_SIZE_;
-  void swap(Deque<T>&);
-  void reallocate(size_t);
+  static constexpr size_t MAX_SIZE_ = ChunkPolicy::template chunk_size<T>();
+  static constexpr size_t SHIFT_ = chunk_shift(MAX_SIZE_);
+  static constexpr size_t MASK_ = MAX_SIZE_ - 1;
+  static_assert((MAX_SIZE_ & MASK_) == 0, "chunk size must be a power of two");
+  static constexpr size_t SPARE_CHUNKS_ = 16;
+
+  // chunks emptied by pops, reused by pushes before asking the allocator
+  T* spare_chunks_[SPARE_CHUNKS_];
+  size_t spare_count_ = 0;
+
+  // the replacement map of an incremental growth, filled a few entries per push. nodes [first, last) of
+  // deque_ land at map[target...]; the work is count entries to write followed by a sweep over deque_
+  // that gives back the chunks outside [first, last). deque_ stays the map in use until the end
+  struct Migration {
+    T** map = nullptr;
+    size_t count = 0;
+    size_t first = 0;
+    size_t last = 0;
+    size_t target = 0;
+    size_t done = 0;
+    size_t step = 0;
+  };
+  Migration migration_;
+
+  // map of a moved-from deque, keeps begin() and end() valid without a branch
+  static inline T* EMPTY_MAP_[1] = {nullptr};
+
+  // block copies bypass AllocTraits::construct, so they are used with the default allocator only
+  static constexpr bool BLOCK_COPYABLE_ =
+      std::is_trivially_copyable_v<T> && std::is_same_v<chunk_allocator_type, std::allocator<T>>;
+  static constexpr bool TRIVIAL_DESTROY_ =
+      std::is_trivially_destructible_v<T> && std::is_same_v<chunk_allocator_type, std::allocator<T>>;
+
+  void reallocate(size_t = 0, size_t = 0);
+  void restore_map();
+  void prepare_front(size_t = 1);
+  void prepare_back(size_t = 1);
+  void ensure_chunk(size_t);
+  void release_chunk(size_t) noexcept;
+  void release_spare_chunks() noexcept;
+  void migrate(size_t, size_t);
+  void migration_work(size_t) noexcept;
+  void finish_migration() noexcept;
+  void release() noexcept;
+  void take(Deque<T, Allocator, ChunkPolicy>&) noexcept;
+  void destroy_front(size_t) noexcept;
+  void destroy_back(size_t) noexcept;
+  void destroy_range(size_t, size_t) noexcept;
+  void move_slots(size_t, size_t, size_t) noexcept;
+
+  // sorted runs are merged pairwise, ping-ponging between this deque and a scratch one. wider merges cost
+  // a branch per element that the predictor cannot learn, the two-way one selects without branching
+  static constexpr size_t SORT_FAN_IN_ = 2;
+  static constexpr size_t SORT_MIN_PIECE_ = 16 * 1024;
+
+  // walks count slots from a global position, one chunk at a time
+  struct SortCursor {
+    T* slot;
+    T* chunk_end;
+    T* const* chunk;
+    size_t left;
+
+    SortCursor() noexcept = default;
+    SortCursor(T* const* map, size_t position, size_t count) noexcept;
+    void advance(size_t step = 1) noexcept;
+  };
+
+  // one merge task: ranges of the source deque that land, merged, at output in the target
+  struct MergePiece {
+    size_t output;
+    std::vector<std::pair<size_t, size_t>> ranges;
+  };
+
+  template<typename Compare>
+  void split_merge(size_t, const std::vector<size_t>&, size_t, size_t, Compare&, std::vector<MergePiece>&) const;
+  template<typename Compare>
+  void merge_piece(Deque<T, Allocator, ChunkPolicy>&, const MergePiece&, Compare&, std::exception_ptr&,
+                   std::atomic<bool>&) const;
+
+  template<typename Block>
+  void construct_blocks(size_t, size_t, Block&&);
+  template<typename InputIt>
+  void copy_construct(size_t, size_t, InputIt);
+  template<typename... Args>
+  void fill_construct(size_t, size_t, const Args&...);
 
   template<bool is_const>
   class CommonIterator;
-
-  CommonIterator<false> begin_, start_, finish_;
+  template<bool is_const>
+  class CommonSegmentIterator;
+  template<bool is_const>
+  class CommonSegmentView;
 
  public:
-  Deque(int);
   Deque();
+  Deque(const Allocator&);
+  Deque(int);
+  Deque(int, const Allocator&);
   Deque(int, const T&);
-  Deque(const Deque<T>&);
+  Deque(int, const T&, const Allocator&);
+  template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+  Deque(InputIt, InputIt, const Allocator& = Allocator());
+  Deque(const Deque<T, Allocator, ChunkPolicy>&);
+  Deque(const Deque<T, Allocator, ChunkPolicy>&, const Allocator&);
+  Deque(Deque<T, Allocator, ChunkPolicy>&&) noexcept;
   ~Deque() noexcept;
 
-  Deque<T>& operator=(const Deque<T>&);
+  Deque<T, Allocator, ChunkPolicy>& operator=(const Deque<T, Allocator, ChunkPolicy>&);
+  Deque<T, Allocator, ChunkPolicy>& operator=(Deque<T, Allocator, ChunkPolicy>&&)
+      noexcept(AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value);
+
+  void swap(Deque<T, Allocator, ChunkPolicy>&) noexcept;
 
+  using allocator_type = Allocator;
   using iterator = CommonIterator<false>;
   using const_iterator = CommonIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using segment = std::span<T>;
+  using const_segment = std::span<const T>;
+  using segment_view = CommonSegmentView<false>;
+  using const_segment_view = CommonSegmentView<true>;
+
+  allocator_type get_allocator() const noexcept;
 
   size_t size() const noexcept;
+  size_t growth_factor() const noexcept;
+  void set_growth_factor(size_t);
+  // off by default: the map grows in one go inside the push that runs out of room. when on, a bigger map
+  // is filled a bounded number of entries per push while the old one still has room, then swapped in
+  bool incremental_growth() const noexcept;
+  void set_incremental_growth(bool);
+  void shrink_to_fit();
+  // pushes at that end that neither grow the map nor allocate a chunk
+  size_t capacity_front() const noexcept;
+  size_t capacity_back() const noexcept;
+  // sets up the map and the chunks for count more elements at that end, growing the map at most once
+  void reserve_front(size_t);
+  void reserve_back(size_t);
+  // destroys the elements and keeps the map and every chunk for the pushes that follow
+  void clear() noexcept;
   T& operator[](ssize_t);
   const T& operator[](ssize_t) const;
   T& at(ssize_t);
   const T& at(ssize_t) const;
+  T& front();
+  const T& front() const;
+  T& back();
+  const T& back() const;
 
   void push_front(const T&);
+  void push_front(T&&);
   void push_back(const T&);
+  void push_back(T&&);
   void pop_front();
   void pop_back();
+
+  template<typename InputIt>
+  void append(InputIt, InputIt);
+  template<typename InputIt>
+  void prepend(InputIt, InputIt);
+  void assign(size_t, const T&);
+  void resize(size_t);
+  void resize(size_t, const T&);
+  // grows the back by count raw slots handed to build as a segment_view; build must construct all of them,
+  // or destroy whatever it constructed and throw, which leaves the deque as it was
+  template<typename Build>
+  void append_uninitialized(size_t, Build&&);
+
+  // sorts every chunk in place, then merges the chunk runs; if comp throws, the deque keeps all of its
+  // elements in an unspecified order. the merge passes move the elements between this deque and a scratch
+  // one of the same size, so a sort needs memory for twice the elements while it runs; with a throwing
+  // move constructor it falls back to std::sort in place
+  template<typename Compare = std::less<>>
+  void sort(Compare = Compare());
+  // the same with the independent steps handed to run_tasks(count, task), which must call task(i) once
+  // for every i < count, in any order and on any threads; wide merges are cut into about pieces parts
+  template<typename Compare, typename RunTasks>
+  void sort(Compare, size_t pieces, RunTasks&&);
+
+  template<typename... Args>
+  T& emplace_front(Args&&...);
+  template<typename... Args>
+  T& emplace_back(Args&&...);
+  template<typename... Args>
+  iterator emplace(iterator, Args&&...);
+
   void insert(iterator, const T&);
-  void erase(iterator);
+  void insert(iterator, T&&);
+  iterator erase(iterator);
+  iterator erase(iterator, iterator);
 
   iterator begin() noexcept;
   const_iterator begin() const noexcept;
@@ -48,137 +269,388 @@ class Deque {
   const_iterator cbegin() const noexcept;
   const_iterator cend() const noexcept;
 
-  std::reverse_iterator<iterator> rbegin() noexcept;
-  std::reverse_iterator<iterator> rend() noexcept;
-  std::reverse_iterator<const_iterator> crbegin() noexcept;
-  std::reverse_iterator<const_iterator> crend() noexcept;
+  reverse_iterator rbegin() noexcept;
+  const_reverse_iterator rbegin() const noexcept;
+  const_reverse_iterator crbegin() const noexcept;
+  reverse_iterator rend() noexcept;
+  const_reverse_iterator rend() const noexcept;
+  const_reverse_iterator crend() const noexcept;
+
+  segment_view segments() noexcept;
+  const_segment_view segments() const noexcept;
+  segment_view segments(size_t, size_t) noexcept;
+  const_segment_view segments(size_t, size_t) const noexcept;
+
+  template<typename Func>
+  void for_each_segment(Func&&);
+  template<typename Func>
+  void for_each_segment(Func&&) const;
+  template<typename Func>
+  void for_each_segment(size_t, size_t, Func&&);
+  template<typename Func>
+  void for_each_segment(size_t, size_t, Func&&) const;
 };
 
-template<typename T>
-const size_t Deque<T>::MAX_SIZE_ = 32;
+template<typename T, typename Allocator, typename ChunkPolicy>
+const size_t Deque<T, Allocator, ChunkPolicy>::START_ARRAY_COUNT_ = 8;
 
-template<typename T>
-const size_t Deque<T>::START_ARRAY_COUNT_ = 8;
+// chunks are allocated only once elements land in them, the map starts out empty
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(const Allocator& allocator)
+    : allocator_(allocator), map_allocator_(allocator), array_count_(START_ARRAY_COUNT_) {
+  deque_ = MapAllocTraits::allocate(map_allocator_, array_count_);
+  std::fill(deque_, deque_ + array_count_, nullptr);
+  offset_ = array_count_ * MAX_SIZE_ / 2;
+}
 
-template<typename T>
-Deque<T>::Deque(int size) : size_(size), array_count_(START_ARRAY_COUNT_) {
-  while (array_count_ * MAX_SIZE_ <= 2 * size_) { // <= !!!
-    array_count_ *= 2;
-  }
-  try {
-    deque_ = reinterpret_cast<T**>(new uint8_t[array_count_ * sizeof(T*)]);
-    for (size_t i = 0; i < array_count_; ++i) {
-      deque_[i] = reinterpret_cast<T*>(new uint8_t[MAX_SIZE_ * sizeof(T)]);
-    }
-  } catch (...) {
-    throw;
-  }
-  begin_ = {deque_ + (array_count_ / 2), MAX_SIZE_ - 1};
-  start_ = {deque_, 0};
-  finish_ = {deque_ + (array_count_ - 1), MAX_SIZE_};
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque() : Deque<T, Allocator, ChunkPolicy>(Allocator()) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(int size, const Allocator& allocator) : Deque<T, Allocator, ChunkPolicy>(allocator) {
+  resize(size);
 }
 
-template<typename T>
-Deque<T>::Deque() try : Deque<T>(0) {} catch (...) {
-  throw;
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(int size) : Deque<T, Allocator, ChunkPolicy>(size, Allocator()) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(int size, const T& to_fill) : Deque<T, Allocator, ChunkPolicy>(size, to_fill, Allocator()) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(int size, const T& to_fill, const Allocator& allocator)
+    : Deque<T, Allocator, ChunkPolicy>(allocator) {
+  resize(size, to_fill);
 }
 
-template<typename T>
-Deque<T>::Deque(int size, const T& to_fill) try : Deque<T>(size) {
-  for (iterator it = begin(); it != end(); ++it) {
-    new(it.get_array() + it.get_index()) T(to_fill);
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(const Deque<T, Allocator, ChunkPolicy>& arg_deque)
+    : Deque<T, Allocator, ChunkPolicy>(arg_deque, AllocTraits::select_on_container_copy_construction(arg_deque.allocator_)) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(const Deque<T, Allocator, ChunkPolicy>& arg_deque, const Allocator& allocator)
+    : Deque<T, Allocator, ChunkPolicy>(allocator) {
+  growth_factor_ = arg_deque.growth_factor_;
+  incremental_growth_ = arg_deque.incremental_growth_;
+  prepare_back(arg_deque.size_);
+  // a chunk of the source is contiguous, so each one is a single block copy for trivially copyable T
+  for (const_segment segment: arg_deque.segments()) {
+    copy_construct(offset_ + size_, segment.size(), segment.data());
+    size_ += segment.size();
   }
-} catch (...) {
-  throw;
 }
 
-template<typename T>
-Deque<T>::Deque(const Deque<T>& arg_deque) try : Deque<T>(arg_deque.size()) {
-  for (auto it = begin(), arg_it = arg_deque.begin(); it != end(); ++it, ++arg_it) {
-    new(it.get_array() + it.get_index()) T(*arg_it);
-  }
-} catch (...) {
-  throw;
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename InputIt, typename>
+Deque<T, Allocator, ChunkPolicy>::Deque(InputIt first, InputIt last, const Allocator& allocator)
+    : Deque<T, Allocator, ChunkPolicy>(allocator) {
+  append(first, last);
 }
 
-template<typename T>
-Deque<T>::~Deque() noexcept {
-  for (iterator it = begin(); it != end(); ++it) {
-    it->~T();
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::Deque(Deque<T, Allocator, ChunkPolicy>&& arg_deque) noexcept
+    : allocator_(arg_deque.allocator_), map_allocator_(arg_deque.map_allocator_),
+      deque_(arg_deque.deque_), size_(arg_deque.size_), offset_(arg_deque.offset_),
+      array_count_(arg_deque.array_count_), growth_factor_(arg_deque.growth_factor_),
+      incremental_growth_(arg_deque.incremental_growth_), migration_(arg_deque.migration_) {
+  std::copy(arg_deque.spare_chunks_, arg_deque.spare_chunks_ + arg_deque.spare_count_, spare_chunks_);
+  spare_count_ = arg_deque.spare_count_;
+  arg_deque.spare_count_ = 0;
+  arg_deque.migration_ = Migration();
+  // moved-from deque owns no map until the next push
+  arg_deque.deque_ = EMPTY_MAP_;
+  arg_deque.size_ = 0;
+  arg_deque.offset_ = 0;
+  arg_deque.array_count_ = 0;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::~Deque() noexcept {
+  release();
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::release() noexcept {
+  if constexpr (!TRIVIAL_DESTROY_) {
+    destroy_range(offset_, offset_ + size_);
   }
   for (size_t i = 0; i < array_count_; ++i) {
-    delete[] reinterpret_cast<uint8_t*>(deque_[i]);
+    if (deque_[i] != nullptr) {
+      AllocTraits::deallocate(allocator_, deque_[i], MAX_SIZE_);
+    }
+  }
+  if (array_count_ > 0) {
+    MapAllocTraits::deallocate(map_allocator_, deque_, array_count_);
+  }
+  // the replacement map only mirrors chunks owned through deque_
+  if (migration_.map != nullptr) {
+    MapAllocTraits::deallocate(map_allocator_, migration_.map, migration_.count);
+    migration_ = Migration();
   }
-  delete[] reinterpret_cast<uint8_t*>(deque_);
+  release_spare_chunks();
+  deque_ = EMPTY_MAP_;
+  size_ = 0;
+  offset_ = 0;
+  array_count_ = 0;
 }
 
-template<typename T>
-void Deque<T>::reallocate(size_t new_array_count) {
-  T** new_deque = reinterpret_cast<T**>(new uint8_t[new_array_count * sizeof(T*)]);
-  for (size_t i = 0; i < new_array_count; ++i) {
-    try {
-      if (i >= array_count_ / 2 && i < array_count_ / 2 + array_count_) {
-        new_deque[i] = deque_[i - array_count_ / 2];
-      } else {
-        new_deque[i] = reinterpret_cast<T*>(new uint8_t[MAX_SIZE_ * sizeof(T)]);
-      }
-    } catch (...) {
-      for (size_t j = 0; j < i; ++j) {
-        if (j < array_count_ || j >= array_count_ / 2 + array_count_) {
-          delete[] reinterpret_cast<uint8_t*>(new_deque[j]);
-        }
-        new_deque[j] = nullptr;
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::take(Deque<T, Allocator, ChunkPolicy>& arg_deque) noexcept {
+  release();
+  allocator_ = arg_deque.allocator_;
+  map_allocator_ = arg_deque.map_allocator_;
+  deque_ = arg_deque.deque_;
+  size_ = arg_deque.size_;
+  offset_ = arg_deque.offset_;
+  array_count_ = arg_deque.array_count_;
+  growth_factor_ = arg_deque.growth_factor_;
+  incremental_growth_ = arg_deque.incremental_growth_;
+  migration_ = arg_deque.migration_;
+  std::copy(arg_deque.spare_chunks_, arg_deque.spare_chunks_ + arg_deque.spare_count_, spare_chunks_);
+  spare_count_ = arg_deque.spare_count_;
+  arg_deque.spare_count_ = 0;
+  arg_deque.migration_ = Migration();
+  arg_deque.deque_ = EMPTY_MAP_;
+  arg_deque.size_ = 0;
+  arg_deque.offset_ = 0;
+  arg_deque.array_count_ = 0;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::reallocate(size_t front_nodes, size_t back_nodes) {
+  finish_migration();
+  // the end slot is kept inside the map, so it counts as occupied
+  size_t first_node = offset_ >> SHIFT_;
+  size_t occupied = ((offset_ + size_) >> SHIFT_) - first_node + 1;
+  // chunks reserved next to the elements move along with them
+  size_t low = first_node;
+  while (low > 0 && deque_[low - 1] != nullptr) {
+    --low;
+  }
+  size_t high = first_node + occupied;
+  while (high < array_count_ && deque_[high] != nullptr) {
+    ++high;
+  }
+  front_nodes = std::max(front_nodes, first_node - low);
+  back_nodes = std::max(back_nodes, high - first_node - occupied);
+  size_t needed = occupied + front_nodes + back_nodes;
+  size_t new_array_count = array_count_;
+  while (2 * needed > new_array_count) {
+    new_array_count *= growth_factor_;
+  }
+  size_t target_node = (new_array_count - needed) / 2 + front_nodes;
+
+  if (new_array_count == array_count_) {
+    // rotating keeps the chunks outside the occupied nodes in the map
+    if (first_node > target_node) {
+      std::rotate(deque_, deque_ + (first_node - target_node), deque_ + array_count_);
+    } else {
+      std::rotate(deque_, deque_ + array_count_ - (target_node - first_node), deque_ + array_count_);
+    }
+  } else {
+    T** new_deque = MapAllocTraits::allocate(map_allocator_, new_array_count);
+    std::fill(new_deque, new_deque + new_array_count, nullptr);
+    std::copy(deque_ + low, deque_ + high, new_deque + target_node - (first_node - low));
+    for (size_t i = 0; i < array_count_; ++i) {
+      if ((i < low || i >= high) && deque_[i] != nullptr) {
+        release_chunk(i);
       }
-      delete[] reinterpret_cast<uint8_t*>(new_deque);
-      throw;
     }
+    MapAllocTraits::deallocate(map_allocator_, deque_, array_count_);
+    deque_ = new_deque;
+    array_count_ = new_array_count;
   }
-  iterator new_begin(new_deque + array_count_ / 2 + (begin().get_ptr() - deque_), begin().get_index());
-  delete[] reinterpret_cast<uint8_t*>(deque_);
-  deque_ = new_deque;
-  array_count_ = new_array_count;
-  begin_ = new_begin;
-  start_ = {deque_, 0};
-  finish_ = {deque_ + (array_count_ - 1), MAX_SIZE_};
+  offset_ = offset_ - first_node * MAX_SIZE_ + target_node * MAX_SIZE_;
 }
 
-template<typename T>
-void Deque<T>::swap(Deque<T>& arg_deque) try {
+// swaps whole storage; allocators are exchanged only if they propagate on swap, otherwise they must be equal
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::swap(Deque<T, Allocator, ChunkPolicy>& arg_deque) noexcept {
+  if constexpr (AllocTraits::propagate_on_container_swap::value) {
+    std::swap(allocator_, arg_deque.allocator_);
+    std::swap(map_allocator_, arg_deque.map_allocator_);
+  }
   std::swap(deque_, arg_deque.deque_);
   std::swap(size_, arg_deque.size_);
-  std::swap(begin_, arg_deque.begin_);
-  std::swap(start_, arg_deque.start_);
-  std::swap(finish_, arg_deque.finish_);
-} catch (...) {
-  throw;
+  std::swap(offset_, arg_deque.offset_);
+  std::swap(array_count_, arg_deque.array_count_);
+  std::swap(growth_factor_, arg_deque.growth_factor_);
+  std::swap(incremental_growth_, arg_deque.incremental_growth_);
+  std::swap(migration_, arg_deque.migration_);
+  std::swap(spare_chunks_, arg_deque.spare_chunks_);
+  std::swap(spare_count_, arg_deque.spare_count_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void swap(Deque<T, Allocator, ChunkPolicy>& left, Deque<T, Allocator, ChunkPolicy>& right) noexcept {
+  left.swap(right);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>& Deque<T, Allocator, ChunkPolicy>::operator=(const Deque<T, Allocator, ChunkPolicy>& deque) {
+  if (this == &deque) {
+    return *this;
+  }
+  if constexpr (BLOCK_COPYABLE_) {
+    // nothing to destroy, so the old chunks are overwritten in place. the room is set up while the old
+    // elements still count, so an allocation that throws leaves them as they were; past it nothing throws
+    if (array_count_ > 0) {
+      prepare_back(deque.size_ - std::min(size_, deque.size_));
+      size_ = 0;
+      for (const_segment segment: deque.segments()) {
+        copy_construct(offset_ + size_, segment.size(), segment.data());
+        size_ += segment.size();
+      }
+      growth_factor_ = deque.growth_factor_;
+      incremental_growth_ = deque.incremental_growth_;
+      return *this;
+    }
+  }
+  Deque<T, Allocator, ChunkPolicy> tmp_deque(deque, AllocTraits::propagate_on_container_copy_assignment::value ?
+                                                    Allocator(deque.allocator_) : Allocator(allocator_));
+  take(tmp_deque);
+  return *this;
 }
 
-template<typename T>
-Deque<T>& Deque<T>::operator=(const Deque<T>& deque) try {
-  Deque<T> tmp_deque(deque);
-  swap(tmp_deque);
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>& Deque<T, Allocator, ChunkPolicy>::operator=(Deque<T, Allocator, ChunkPolicy>&& deque)
+    noexcept(AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value) {
+  if (this == &deque) {
+    return *this;
+  }
+  if (AllocTraits::propagate_on_container_move_assignment::value || allocator_ == deque.allocator_) {
+    take(deque);
+  } else {
+    // storage of a foreign allocator cannot be stolen, move the elements one by one
+    Deque<T, Allocator, ChunkPolicy> tmp_deque{Allocator(allocator_)};
+    for (auto it = deque.begin(); it != deque.end(); ++it) {
+      tmp_deque.emplace_back(std::move(*it));
+    }
+    take(tmp_deque);
+  }
   return *this;
-} catch (...) {
-  throw;
 }
 
-template<typename T>
-size_t Deque<T>::size() const noexcept {
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::allocator_type Deque<T, Allocator, ChunkPolicy>::get_allocator() const noexcept {
+  return Allocator(allocator_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t Deque<T, Allocator, ChunkPolicy>::size() const noexcept {
   return size_;
 }
 
-template<typename T>
-T& Deque<T>::operator[](ssize_t index) {
-  return *(begin_ + index);
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t Deque<T, Allocator, ChunkPolicy>::growth_factor() const noexcept {
+  return growth_factor_;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::shrink_to_fit() {
+  finish_migration();
+  release_spare_chunks();
+  if (array_count_ == 0) {
+    return;
+  }
+  size_t first_node = offset_ >> SHIFT_;
+  size_t last_node = (offset_ + size_) >> SHIFT_;
+  size_t new_array_count = last_node - first_node + 1;
+  T** new_deque = MapAllocTraits::allocate(map_allocator_, new_array_count);
+  for (size_t i = 0; i < array_count_; ++i) {
+    if (i >= first_node && i <= last_node) {
+      new_deque[i - first_node] = deque_[i];
+    } else if (deque_[i] != nullptr) {
+      AllocTraits::deallocate(allocator_, deque_[i], MAX_SIZE_);
+    }
+  }
+  MapAllocTraits::deallocate(map_allocator_, deque_, array_count_);
+  deque_ = new_deque;
+  offset_ -= first_node * MAX_SIZE_;
+  array_count_ = new_array_count;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+bool Deque<T, Allocator, ChunkPolicy>::incremental_growth() const noexcept {
+  return incremental_growth_;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::set_incremental_growth(bool enabled) {
+  if (!enabled) {
+    finish_migration();
+  }
+  incremental_growth_ = enabled;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t Deque<T, Allocator, ChunkPolicy>::capacity_front() const noexcept {
+  size_t first = offset_;
+  while (first > 0 && deque_[(first - 1) >> SHIFT_] != nullptr) {
+    first = ((first - 1) >> SHIFT_) << SHIFT_;
+  }
+  return offset_ - first;
+}
+
+// prepare_back keeps the end slot inside the map, hence the last slot of the map never counts
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t Deque<T, Allocator, ChunkPolicy>::capacity_back() const noexcept {
+  if (array_count_ == 0) {
+    return 0;
+  }
+  size_t position = offset_ + size_;
+  size_t node = position >> SHIFT_;
+  while (node < array_count_ && deque_[node] != nullptr) {
+    ++node;
+  }
+  size_t last = std::min(node * MAX_SIZE_, array_count_ * MAX_SIZE_ - 1);
+  return last > position ? last - position : 0;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::reserve_front(size_t count) {
+  if (count > 0) {
+    prepare_front(count);
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::reserve_back(size_t count) {
+  if (count > 0) {
+    prepare_back(count);
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::clear() noexcept {
+  if constexpr (!TRIVIAL_DESTROY_) {
+    destroy_range(offset_, offset_ + size_);
+  }
+  size_ = 0;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::set_growth_factor(size_t growth_factor) {
+  if (growth_factor < 2) {
+    throw std::invalid_argument("growth factor must be at least 2");
+  }
+  growth_factor_ = growth_factor;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+T& Deque<T, Allocator, ChunkPolicy>::operator[](ssize_t index) {
+  size_t position = offset_ + index;
+  return deque_[position >> SHIFT_][position & MASK_];
 }
 
-template<typename T>
-const T& Deque<T>::operator[](ssize_t index) const {
-  return *(begin_ + index);
+template<typename T, typename Allocator, typename ChunkPolicy>
+const T& Deque<T, Allocator, ChunkPolicy>::operator[](ssize_t index) const {
+  size_t position = offset_ + index;
+  return deque_[position >> SHIFT_][position & MASK_];
 }
 
-template<typename T>
-T& Deque<T>::at(ssize_t index) {
+template<typename T, typename Allocator, typename ChunkPolicy>
+T& Deque<T, Allocator, ChunkPolicy>::at(ssize_t index) {
   if (index < 0 || index >= ssize_t(size_)) {
     throw std::out_of_range("out of range");
   } else {
@@ -186,149 +658,907 @@ T& Deque<T>::at(ssize_t index) {
   }
 }
 
-template<typename T>
-const T& Deque<T>::at(ssize_t index) const {
-  if (index < 0 || index >= size_) {
+template<typename T, typename Allocator, typename ChunkPolicy>
+const T& Deque<T, Allocator, ChunkPolicy>::at(ssize_t index) const {
+  if (index < 0 || index >= ssize_t(size_)) {
     throw std::out_of_range("out of range");
   } else {
     return this->operator[](index);
   }
 }
 
-template<typename T>
-void Deque<T>::push_front(const T& element) {
-  if (begin() == start_) {
-    reallocate(2 * array_count_); // iterator's invalidation
+template<typename T, typename Allocator, typename ChunkPolicy>
+T& Deque<T, Allocator, ChunkPolicy>::front() {
+  return (*this)[0];
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+const T& Deque<T, Allocator, ChunkPolicy>::front() const {
+  return (*this)[0];
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+T& Deque<T, Allocator, ChunkPolicy>::back() {
+  return (*this)[size_ - 1];
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+const T& Deque<T, Allocator, ChunkPolicy>::back() const {
+  return (*this)[size_ - 1];
+}
+
+// gives a moved-from deque an empty map again, keeping its map growth settings
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::restore_map() {
+  Deque<T, Allocator, ChunkPolicy> fresh{Allocator(allocator_)};
+  fresh.growth_factor_ = growth_factor_;
+  fresh.incremental_growth_ = incremental_growth_;
+  take(fresh);
+}
+
+// makes room for count elements before begin(), allocating every chunk they will land in
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::prepare_front(size_t count) {
+  if (array_count_ == 0) {
+    restore_map();
+  }
+  if (incremental_growth_) {
+    migrate(count, 0);
+  }
+  if (offset_ < count) {
+    size_t in_node = offset_ & MASK_;
+    reallocate(((count - in_node - 1) >> SHIFT_) + 1, 0); // iterator's invalidation
+  }
+  for (size_t node = (offset_ - count) >> SHIFT_; count > 0 && node <= (offset_ - 1) >> SHIFT_; ++node) {
+    ensure_chunk(node);
   }
-  --begin_;
-  auto it = begin();
-  new(it.get_array() + it.get_index()) T(element);
-  ++size_;
 }
 
-template<typename T>
-void Deque<T>::push_back(const T& element) {
-  if (end() == finish_ - 1) {
-    reallocate(2 * array_count_); // iterator's invalidation
+// makes room for count elements past end(), allocating every chunk they will land in
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::prepare_back(size_t count) {
+  if (array_count_ == 0) {
+    restore_map();
+  }
+  if (incremental_growth_) {
+    migrate(0, count);
+  }
+  size_t position = offset_ + size_;
+  if (position + count >= array_count_ * MAX_SIZE_) {
+    reallocate(0, ((position + count) >> SHIFT_) - (position >> SHIFT_)); // iterator's invalidation
+    position = offset_ + size_;
   }
+  for (size_t node = position >> SHIFT_; count > 0 && node <= (position + count - 1) >> SHIFT_; ++node) {
+    ensure_chunk(node);
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::ensure_chunk(size_t node) {
+  if (deque_[node] == nullptr) {
+    deque_[node] = (spare_count_ > 0) ? spare_chunks_[--spare_count_] : AllocTraits::allocate(allocator_, MAX_SIZE_);
+    if (migration_.map != nullptr && node >= migration_.first && node < migration_.last &&
+        node - migration_.first + migration_.target < migration_.done) {
+      migration_.map[node - migration_.first + migration_.target] = deque_[node];
+    }
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::release_chunk(size_t node) noexcept {
+  if (spare_count_ < SPARE_CHUNKS_) {
+    spare_chunks_[spare_count_++] = deque_[node];
+  } else {
+    AllocTraits::deallocate(allocator_, deque_[node], MAX_SIZE_);
+  }
+  deque_[node] = nullptr;
+  if (migration_.map != nullptr && node >= migration_.first && node < migration_.last &&
+      node - migration_.first + migration_.target < migration_.done) {
+    migration_.map[node - migration_.first + migration_.target] = nullptr;
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::release_spare_chunks() noexcept {
+  for (; spare_count_ > 0; --spare_count_) {
+    AllocTraits::deallocate(allocator_, spare_chunks_[spare_count_ - 1], MAX_SIZE_);
+  }
+}
+
+// called by every prepare_front/prepare_back in incremental mode. a migration starts once either end is within
+// a sixteenth of the map from its edge and carries that many nodes of slack on both sides; the step is set so
+// that the work is done before the pushes can use up the slack. a request that reaches past it finishes the
+// migration on the spot and leaves the rest to reallocate
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::migrate(size_t front_count, size_t back_count) {
+  if (migration_.map != nullptr) {
+    bool inside = offset_ >= front_count && ((offset_ - front_count) >> SHIFT_) >= migration_.first &&
+                  ((offset_ + size_ + back_count) >> SHIFT_) < migration_.last;
+    migration_work(inside ? migration_.step : SIZE_MAX);
+    return;
+  }
+  size_t first_node = offset_ >> SHIFT_;
+  size_t last_node = (offset_ + size_) >> SHIFT_;
+  size_t margin = array_count_ / 16 + 1;
+  size_t front_margin = std::min(margin, first_node);
+  size_t back_margin = std::min(margin, array_count_ - 1 - last_node);
+  if (front_margin == margin && back_margin == margin) {
+    return;
+  }
+  size_t needed = last_node + 1 + back_margin - (first_node - front_margin);
+  size_t new_array_count = array_count_;
+  while (2 * needed > new_array_count) {
+    new_array_count *= growth_factor_;
+  }
+  T** map = MapAllocTraits::allocate(map_allocator_, new_array_count);
+  size_t units = new_array_count + array_count_;
+  size_t pushes = std::min(front_margin, back_margin) * MAX_SIZE_;
+  migration_.map = map;
+  migration_.count = new_array_count;
+  migration_.first = first_node - front_margin;
+  migration_.last = last_node + 1 + back_margin;
+  migration_.target = (new_array_count - needed) / 2;
+  migration_.done = 0;
+  migration_.step = pushes == 0 ? units : (units + pushes - 1) / pushes;
+  migration_work(migration_.step);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::migration_work(size_t units) noexcept {
+  Migration& m = migration_;
+  size_t total = m.count + array_count_;
+  size_t stop = units >= total - m.done ? total : m.done + units;
+  for (; m.done < stop && m.done < m.count; ++m.done) {
+    size_t node = m.done - m.target + m.first;
+    m.map[m.done] = (m.done >= m.target && node < m.last) ? deque_[node] : nullptr;
+  }
+  for (; m.done < stop; ++m.done) {
+    size_t node = m.done - m.count;
+    if ((node < m.first || node >= m.last) && deque_[node] != nullptr) {
+      release_chunk(node);
+    }
+  }
+  if (m.done == total) {
+    MapAllocTraits::deallocate(map_allocator_, deque_, array_count_);
+    offset_ = offset_ - m.first * MAX_SIZE_ + m.target * MAX_SIZE_;
+    deque_ = m.map;
+    array_count_ = m.count;
+    m = Migration();
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::finish_migration() noexcept {
+  if (migration_.map != nullptr) {
+    migration_work(SIZE_MAX);
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+T& Deque<T, Allocator, ChunkPolicy>::emplace_front(Args&&... args) {
+  prepare_front();
+  auto it = begin() - 1;
+  AllocTraits::construct(allocator_, it.get_array() + it.get_index(), std::forward<Args>(args)...);
+  --offset_;
+  ++size_;
+  return *it;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+T& Deque<T, Allocator, ChunkPolicy>::emplace_back(Args&&... args) {
+  prepare_back();
   auto it = end();
-  new(it.get_array() + it.get_index()) T(element);
+  AllocTraits::construct(allocator_, it.get_array() + it.get_index(), std::forward<Args>(args)...);
   ++size_;
+  return *it;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::push_front(const T& element) {
+  emplace_front(element);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::push_front(T&& element) {
+  emplace_front(std::move(element));
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::push_back(const T& element) {
+  emplace_back(element);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::push_back(T&& element) {
+  emplace_back(std::move(element));
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::destroy_front(size_t count) noexcept {
+  // one chunk at a time: the destructor loop is skipped for trivial T, every emptied chunk goes back
+  while (count > 0) {
+    size_t length = std::min(count, MAX_SIZE_ - (offset_ & MASK_));
+    if constexpr (!TRIVIAL_DESTROY_) {
+      destroy_range(offset_, offset_ + length);
+    }
+    offset_ += length;
+    size_ -= length;
+    count -= length;
+    if ((offset_ & MASK_) == 0) {
+      release_chunk((offset_ >> SHIFT_) - 1);
+    }
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::destroy_back(size_t count) noexcept {
+  while (count > 0) {
+    size_t position = offset_ + size_;
+    size_t length = std::min(count, ((position - 1) & MASK_) + 1);
+    if constexpr (!TRIVIAL_DESTROY_) {
+      destroy_range(position - length, position);
+    }
+    size_ -= length;
+    count -= length;
+    if (((position - length) & MASK_) == 0) {
+      release_chunk((position - length) >> SHIFT_);
+    }
+  }
+}
+
+// destroys the elements in the global slots [first, last), leaving size_ and offset_ alone
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::destroy_range(size_t first, size_t last) noexcept {
+  for (; first != last; ++first) {
+    AllocTraits::destroy(allocator_, deque_[first >> SHIFT_] + (first & MASK_));
+  }
+}
+
+// memmove over the global slots: count elements from src to dst, the ranges may overlap
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::move_slots(size_t dst, size_t src, size_t count) noexcept {
+  static_assert(std::is_trivially_copyable_v<T>, "slots are moved as raw bytes");
+  if (dst < src) {
+    while (count > 0) {
+      size_t length = std::min({count, MAX_SIZE_ - (src & MASK_), MAX_SIZE_ - (dst & MASK_)});
+      std::memmove(deque_[dst >> SHIFT_] + (dst & MASK_), deque_[src >> SHIFT_] + (src & MASK_), length * sizeof(T));
+      dst += length;
+      src += length;
+      count -= length;
+    }
+  } else if (dst > src) {
+    dst += count;
+    src += count;
+    while (count > 0) {
+      size_t length = std::min({count, ((src - 1) & MASK_) + 1, ((dst - 1) & MASK_) + 1});
+      dst -= length;
+      src -= length;
+      count -= length;
+      std::memmove(deque_[dst >> SHIFT_] + (dst & MASK_), deque_[src >> SHIFT_] + (src & MASK_), length * sizeof(T));
+    }
+  }
+}
+
+// builds count elements from the global slot position on, handing block() one contiguous piece per chunk;
+// block() either constructs the whole piece or throws having constructed nothing
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Block>
+void Deque<T, Allocator, ChunkPolicy>::construct_blocks(size_t position, size_t count, Block&& block) {
+  size_t done = 0;
+  try {
+    while (done < count) {
+      size_t current = position + done;
+      size_t length = std::min(MAX_SIZE_ - (current & MASK_), count - done);
+      block(deque_[current >> SHIFT_] + (current & MASK_), length);
+      done += length;
+    }
+  } catch (...) {
+    destroy_range(position, position + done);
+    throw;
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename InputIt>
+void Deque<T, Allocator, ChunkPolicy>::copy_construct(size_t position, size_t count, InputIt first) {
+  construct_blocks(position, count, [&](T* block, size_t length) {
+    if constexpr (BLOCK_COPYABLE_ && std::is_pointer_v<InputIt>) {
+      std::uninitialized_copy_n(first, length, block);
+      first += length;
+    } else {
+      size_t i = 0;
+      try {
+        for (; i < length; ++i, ++first) {
+          AllocTraits::construct(allocator_, block + i, *first);
+        }
+      } catch (...) {
+        for (; i > 0; --i) {
+          AllocTraits::destroy(allocator_, block + i - 1);
+        }
+        throw;
+      }
+    }
+  });
+}
+
+// an empty args pack value-initializes the elements
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+void Deque<T, Allocator, ChunkPolicy>::fill_construct(size_t position, size_t count, const Args&... args) {
+  construct_blocks(position, count, [&](T* block, size_t length) {
+    if constexpr (BLOCK_COPYABLE_ && sizeof...(Args) == 0) {
+      std::uninitialized_value_construct_n(block, length);
+    } else if constexpr (BLOCK_COPYABLE_) {
+      std::uninitialized_fill_n(block, length, args...);
+    } else {
+      size_t i = 0;
+      try {
+        for (; i < length; ++i) {
+          AllocTraits::construct(allocator_, block + i, args...);
+        }
+      } catch (...) {
+        for (; i > 0; --i) {
+          AllocTraits::destroy(allocator_, block + i - 1);
+        }
+        throw;
+      }
+    }
+  });
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename InputIt>
+void Deque<T, Allocator, ChunkPolicy>::append(InputIt first, InputIt last) {
+  using category = typename std::iterator_traits<InputIt>::iterator_category;
+  if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+    size_t count = std::distance(first, last);
+    prepare_back(count);
+    copy_construct(offset_ + size_, count, first);
+    size_ += count;
+  } else {
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
 }
 
-template<typename T>
-void Deque<T>::pop_front() try {
-  this->erase(begin());
-} catch (...) {
-  throw;
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename InputIt>
+void Deque<T, Allocator, ChunkPolicy>::prepend(InputIt first, InputIt last) {
+  using category = typename std::iterator_traits<InputIt>::iterator_category;
+  if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+    size_t count = std::distance(first, last);
+    prepare_front(count);
+    copy_construct(offset_ - count, count, first);
+    offset_ -= count;
+    size_ += count;
+  } else {
+    // a single pass range can only be pushed one by one, which reverses it
+    size_t old_size = size_;
+    try {
+      for (; first != last; ++first) {
+        emplace_front(*first);
+      }
+    } catch (...) {
+      destroy_front(size_ - old_size);
+      throw;
+    }
+    std::reverse(begin(), begin() + (size_ - old_size));
+  }
 }
 
-template<typename T>
-void Deque<T>::pop_back() try {
-  this->erase(end() - 1);
-} catch (...) {
-  throw;
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::assign(size_t count, const T& value) {
+  T copy(value); // value may live in this deque
+  destroy_back(size_);
+  resize(count, copy);
 }
 
-template<typename T>
-void Deque<T>::erase(iterator iter) {
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::resize(size_t count) {
+  if (count <= size_) {
+    destroy_back(size_ - count);
+    return;
+  }
+  prepare_back(count - size_);
+  fill_construct(offset_ + size_, count - size_);
+  size_ = count;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::resize(size_t count, const T& value) {
+  if (count <= size_) {
+    destroy_back(size_ - count);
+    return;
+  }
+  prepare_back(count - size_);
+  fill_construct(offset_ + size_, count - size_, value);
+  size_ = count;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Build>
+void Deque<T, Allocator, ChunkPolicy>::append_uninitialized(size_t count, Build&& build) {
+  if (count == 0) {
+    return;
+  }
+  prepare_back(count);
+  build(segment_view(deque_, offset_ + size_, offset_ + size_ + count));
+  size_ += count;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+Deque<T, Allocator, ChunkPolicy>::SortCursor::SortCursor(T* const* map, size_t position, size_t count) noexcept
+    : chunk(map + (position >> SHIFT_)), left(count) {
+  slot = *chunk + (position & MASK_);
+  chunk_end = *chunk + MAX_SIZE_;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::SortCursor::advance(size_t step) noexcept {
+  left -= step;
+  slot += step;
+  if (slot == chunk_end && left > 0) {
+    slot = *++chunk;
+    chunk_end = slot + MAX_SIZE_;
+  }
+}
+
+// cuts the merge of runs bounds[first..last] into up to pieces parts. splitters are sampled elements ordered by
+// (value, run, position), which stays a strict order under duplicates, so every part gets its share
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Compare>
+void Deque<T, Allocator, ChunkPolicy>::split_merge(size_t pieces, const std::vector<size_t>& bounds, size_t first,
+                                                   size_t last, Compare& comp,
+                                                   std::vector<MergePiece>& result) const {
+  size_t length = bounds[last] - bounds[first];
+  pieces = std::min(pieces, std::max<size_t>(1, length / SORT_MIN_PIECE_));
+  std::vector<std::pair<size_t, size_t>> samples; // (run, position)
+  if (pieces > 1) {
+    size_t stride = std::max<size_t>(1, length / (pieces * 16));
+    for (size_t run = first; run < last; ++run) {
+      for (size_t position = bounds[run] + stride / 2; position < bounds[run + 1]; position += stride) {
+        samples.emplace_back(run, position);
+      }
+    }
+    std::sort(samples.begin(), samples.end(), [&](const auto& left, const auto& right) {
+      const T& a = (*this)[left.second];
+      const T& b = (*this)[right.second];
+      return comp(a, b) || (!comp(b, a) && left < right);
+    });
+    pieces = std::min(pieces, samples.size());
+  }
+
+  std::vector<size_t> starts(bounds.begin() + first, bounds.begin() + last);
+  size_t output = bounds[first];
+  for (size_t piece = 1; piece <= pieces; ++piece) {
+    std::vector<size_t> ends(bounds.begin() + first + 1, bounds.begin() + last + 1);
+    if (piece < pieces) {
+      auto [split_run, split_position] = samples[piece * samples.size() / pieces];
+      const T& splitter = (*this)[split_position];
+      for (size_t run = first; run < last; ++run) {
+        size_t low = starts[run - first];
+        size_t high = ends[run - first];
+        if (run == split_run) {
+          low = split_position;
+        }
+        while (run != split_run && low < high) {
+          size_t middle = low + (high - low) / 2;
+          const T& value = (*this)[middle];
+          bool before = run < split_run ? !comp(splitter, value) : comp(value, splitter);
+          if (before) {
+            low = middle + 1;
+          } else {
+            high = middle;
+          }
+        }
+        ends[run - first] = low;
+      }
+    }
+    MergePiece merge{output, {}};
+    for (size_t run = first; run < last; ++run) {
+      if (starts[run - first] < ends[run - first]) {
+        merge.ranges.emplace_back(starts[run - first], ends[run - first] - starts[run - first]);
+        output += ends[run - first] - starts[run - first];
+      }
+    }
+    if (!merge.ranges.empty()) {
+      result.push_back(std::move(merge));
+    }
+    starts = std::move(ends);
+  }
+}
+
+// moves the elements of piece from this deque into the raw slots of target, destroying the sources. if comp
+// throws, the remaining elements are moved over unmerged so that the pass still completes, and the first
+// exception is kept in error
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Compare>
+void Deque<T, Allocator, ChunkPolicy>::merge_piece(Deque<T, Allocator, ChunkPolicy>& target, const MergePiece& piece,
+                                                   Compare& comp, std::exception_ptr& error,
+                                                   std::atomic<bool>& failed) const {
+  // nothing here may allocate: a failure before the elements have moved would strand them
+  chunk_allocator_type allocator(allocator_);
+  size_t total = 0;
+  size_t cursor_count = piece.ranges.size();
+  SortCursor cursors[SORT_FAN_IN_];
+  for (size_t i = 0; i < cursor_count; ++i) {
+    cursors[i] = SortCursor(deque_, offset_ + piece.ranges[i].first, piece.ranges[i].second);
+    total += piece.ranges[i].second;
+  }
+  SortCursor out(target.deque_, target.offset_ + piece.output, total);
+  auto move_one = [&](SortCursor& from) {
+    AllocTraits::construct(allocator, out.slot, std::move(*from.slot));
+    AllocTraits::destroy(allocator, from.slot);
+    from.advance();
+    out.advance();
+  };
+
+  try {
+    if (cursor_count == 2) {
+      SortCursor& left = cursors[0];
+      SortCursor& right = cursors[1];
+      while (left.left > 0 && right.left > 0) {
+        bool take_right = comp(*right.slot, *left.slot);
+        T* from = take_right ? right.slot : left.slot;
+        AllocTraits::construct(allocator, out.slot, std::move(*from));
+        AllocTraits::destroy(allocator, from);
+        out.advance();
+        right.advance(take_right);
+        left.advance(!take_right);
+      }
+    }
+  } catch (...) {
+    if (!failed.exchange(true)) {
+      error = std::current_exception();
+    }
+  }
+  // whatever is left: the tail of a two-way merge, a single range, or everything after a failed comparison
+  for (size_t i = 0; i < cursor_count; ++i) {
+    while (cursors[i].left > 0) {
+      move_one(cursors[i]);
+    }
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Compare>
+void Deque<T, Allocator, ChunkPolicy>::sort(Compare comp) {
+  sort(comp, 1, [](size_t count, auto&& task) {
+    for (size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+  });
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Compare, typename RunTasks>
+void Deque<T, Allocator, ChunkPolicy>::sort(Compare comp, size_t pieces, RunTasks&& run_tasks) {
+  if (size_ < 2) {
+    return;
+  }
+  if constexpr (!std::is_nothrow_move_constructible_v<T>) {
+    // a throwing move could strand elements between the two storages
+    std::sort(begin(), end(), comp);
+  } else {
+    std::vector<segment> runs;
+    std::vector<size_t> bounds{0};
+    for (segment run: segments()) {
+      runs.push_back(run);
+      bounds.push_back(bounds.back() + run.size());
+    }
+    run_tasks(runs.size(), [&](size_t i) { std::sort(runs[i].begin(), runs[i].end(), comp); });
+    if (runs.size() == 1) {
+      return;
+    }
+
+    // a second full set of chunks, freed with whichever storage the elements do not end up in
+    Deque<T, Allocator, ChunkPolicy> scratch{Allocator(allocator_)};
+    scratch.prepare_back(size_);
+    Deque<T, Allocator, ChunkPolicy>* source = this;
+    Deque<T, Allocator, ChunkPolicy>* target = &scratch;
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    while (bounds.size() > 2) {
+      size_t run_count = bounds.size() - 1;
+      size_t groups = (run_count + SORT_FAN_IN_ - 1) / SORT_FAN_IN_;
+      std::vector<MergePiece> merges;
+      std::vector<size_t> merged_bounds{0};
+      for (size_t first = 0; first < run_count; first += SORT_FAN_IN_) {
+        size_t last = std::min(first + SORT_FAN_IN_, run_count);
+        source->split_merge((pieces + groups - 1) / groups, bounds, first, last, comp, merges);
+        merged_bounds.push_back(bounds[last]);
+      }
+      run_tasks(merges.size(), [&](size_t i) { source->merge_piece(*target, merges[i], comp, error, failed); });
+      bounds = std::move(merged_bounds);
+      std::swap(source, target);
+      if (failed.load()) {
+        break;
+      }
+    }
+    if (source != this) {
+      // the elements ended up in the scratch chunks, which simply take the place of ours; the map growth
+      // settings go with them, swap would hand ours to the scratch deque
+      scratch.size_ = size_;
+      scratch.growth_factor_ = growth_factor_;
+      scratch.incremental_growth_ = incremental_growth_;
+      size_ = 0;
+      swap(scratch);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::pop_front() {
+  if (size_ == 0) {
+    throw std::out_of_range("deque is empty");
+  }
+  destroy_front(1);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::pop_back() {
+  if (size_ == 0) {
+    throw std::out_of_range("deque is empty");
+  }
+  destroy_back(1);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::iterator Deque<T, Allocator, ChunkPolicy>::erase(iterator iter) {
   if (size_ == 0) {
     throw std::out_of_range("deque is empty");
   } else if (iter < begin() || iter >= end()) {
     throw std::out_of_range("out of range");
   }
-  if (iter == begin_) {
-    ++begin_;
+  return erase(iter, iter + 1);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::iterator Deque<T, Allocator, ChunkPolicy>::erase(iterator first, iterator last) {
+  if (first < begin() || last > end() || last < first) {
+    throw std::out_of_range("out of range");
+  }
+  size_t index = first - begin();
+  size_t count = last - first;
+  if (count == 0) {
+    // the shifts below would move every element onto itself
+    return first;
+  }
+  // shift the shorter side over the gap, then destroy the vacated slots at that end
+  if (index < size_ - index - count) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      move_slots(offset_ + count, offset_, index);
+    } else {
+      for (iterator it = last; it != begin() + count; --it) {
+        *(it - 1) = std::move(*(it - 1 - count));
+      }
+    }
+    destroy_front(count);
   } else {
-    for (auto it = iter; it + 1 != end(); ++it) {
-      *it = *(it + 1);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      move_slots(offset_ + index, offset_ + index + count, size_ - index - count);
+    } else {
+      for (iterator it = first; it + count != end(); ++it) {
+        *it = std::move(*(it + count));
+      }
     }
+    destroy_back(count);
   }
-  --size_;
+  return begin() + index;
 }
 
-template<typename T>
-void Deque<T>::insert(iterator iter, const T& element) {
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+typename Deque<T, Allocator, ChunkPolicy>::iterator Deque<T, Allocator, ChunkPolicy>::emplace(iterator iter, Args&&... args) {
   if (iter < begin() || iter > end()) {
     throw std::out_of_range("out of range");
   }
-  if (end() == finish_) {
-    reallocate(2 * array_count_); // iterator's invalidation
+  size_t index = iter - begin();
+  if (index == 0) {
+    emplace_front(std::forward<Args>(args)...);
+    return begin();
   }
-  Deque<T> tmp_deque(*this);
-  try {
-    ++size_;
-    for (auto it = end(); it != iter; --it) {
-      *it = *(it - 1);
+  if (index == size_) {
+    emplace_back(std::forward<Args>(args)...);
+    return begin() + index;
+  }
+  T element(std::forward<Args>(args)...);
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    // nothing can throw once the new slot exists, the shorter half is moved as raw bytes
+    if (index < size_ - index) {
+      emplace_front(front());
+      move_slots(offset_ + 1, offset_ + 2, index - 1);
+    } else {
+      emplace_back(back());
+      move_slots(offset_ + index + 1, offset_ + index, size_ - index - 2);
     }
-    *iter = element;
-  } catch (...) {
-    *this = tmp_deque;
-    throw;
+    iterator pos = begin() + index;
+    *pos = element;
+    return pos;
+  }
+  // shift the shorter half; on exception the shifted slots are restored from their neighbours
+  if (index < size_ - index) {
+    emplace_front(std::move_if_noexcept(*begin()));
+    iterator pos = begin() + index;
+    iterator it = begin() + 1;
+    try {
+      for (; it != pos; ++it) {
+        *it = std::move_if_noexcept(*(it + 1));
+      }
+      *pos = std::move_if_noexcept(element);
+    } catch (...) {
+      for (; it != begin(); --it) {
+        *it = std::move_if_noexcept(*(it - 1));
+      }
+      pop_front();
+      throw;
+    }
+    return pos;
+  } else {
+    emplace_back(std::move_if_noexcept(*(end() - 1)));
+    iterator pos = begin() + index;
+    iterator it = end() - 2;
+    try {
+      for (; it != pos; --it) {
+        *it = std::move_if_noexcept(*(it - 1));
+      }
+      *pos = std::move_if_noexcept(element);
+    } catch (...) {
+      for (; it != end() - 1; ++it) {
+        *it = std::move_if_noexcept(*(it + 1));
+      }
+      pop_back();
+      throw;
+    }
+    return pos;
   }
 }
 
-template<typename T>
-typename Deque<T>::iterator Deque<T>::begin() noexcept {
-  return begin_;
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::insert(iterator iter, const T& element) {
+  emplace(iter, element);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void Deque<T, Allocator, ChunkPolicy>::insert(iterator iter, T&& element) {
+  emplace(iter, std::move(element));
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::iterator Deque<T, Allocator, ChunkPolicy>::begin() noexcept {
+  return iterator(deque_ + (offset_ >> SHIFT_), offset_ & MASK_);
 }
 
-template<typename T>
-typename Deque<T>::iterator Deque<T>::end() noexcept {
-  return begin_ + size_;
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::iterator Deque<T, Allocator, ChunkPolicy>::end() noexcept {
+  size_t position = offset_ + size_;
+  return iterator(deque_ + (position >> SHIFT_), position & MASK_);
 }
 
-template<typename T>
-typename Deque<T>::const_iterator Deque<T>::cbegin() const noexcept {
-  return const_iterator(begin_);
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_iterator Deque<T, Allocator, ChunkPolicy>::cbegin() const noexcept {
+  return const_iterator(deque_ + (offset_ >> SHIFT_), offset_ & MASK_);
 }
 
-template<typename T>
-typename Deque<T>::const_iterator Deque<T>::begin() const noexcept {
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_iterator Deque<T, Allocator, ChunkPolicy>::begin() const noexcept {
   return cbegin();
 }
 
-template<typename T>
-typename Deque<T>::const_iterator Deque<T>::cend() const noexcept {
-  return const_iterator(begin_ + size_);
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_iterator Deque<T, Allocator, ChunkPolicy>::cend() const noexcept {
+  size_t position = offset_ + size_;
+  return const_iterator(deque_ + (position >> SHIFT_), position & MASK_);
 }
 
-template<typename T>
-typename Deque<T>::const_iterator Deque<T>::end() const noexcept {
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_iterator Deque<T, Allocator, ChunkPolicy>::end() const noexcept {
   return cend();
 }
 
-template<typename T>
-std::reverse_iterator<typename Deque<T>::iterator> rbegin() noexcept {
-  return std::reverse_iterator(Deque<T>::end());
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::reverse_iterator Deque<T, Allocator, ChunkPolicy>::rbegin() noexcept {
+  return reverse_iterator(end());
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_reverse_iterator Deque<T, Allocator, ChunkPolicy>::rbegin() const noexcept {
+  return crbegin();
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_reverse_iterator Deque<T, Allocator, ChunkPolicy>::crbegin() const noexcept {
+  return const_reverse_iterator(cend());
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::reverse_iterator Deque<T, Allocator, ChunkPolicy>::rend() noexcept {
+  return reverse_iterator(begin());
 }
 
-template<typename T>
-std::reverse_iterator<typename Deque<T>::iterator> Deque<T>::rend() noexcept {
-  return std::reverse_iterator(Deque<T>::begin());
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_reverse_iterator Deque<T, Allocator, ChunkPolicy>::rend() const noexcept {
+  return crend();
 }
 
-template<typename T>
-std::reverse_iterator<typename Deque<T>::const_iterator> Deque<T>::crbegin() noexcept {
-  return std::reverse_iterator(Deque<T>::cend());
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_reverse_iterator Deque<T, Allocator, ChunkPolicy>::crend() const noexcept {
+  return const_reverse_iterator(cbegin());
 }
 
-template<typename T>
-std::reverse_iterator<typename Deque<T>::const_iterator> Deque<T>::crend() noexcept {
-  return std::reverse_iterator(Deque<T>::cbegin());
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::segment_view Deque<T, Allocator, ChunkPolicy>::segments() noexcept {
+  return segment_view(deque_, offset_, offset_ + size_);
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_segment_view Deque<T, Allocator, ChunkPolicy>::segments() const noexcept {
+  return const_segment_view(deque_, offset_, offset_ + size_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::segment_view
+Deque<T, Allocator, ChunkPolicy>::segments(size_t first, size_t last) noexcept {
+  return segment_view(deque_, offset_ + first, offset_ + last);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename Deque<T, Allocator, ChunkPolicy>::const_segment_view
+Deque<T, Allocator, ChunkPolicy>::segments(size_t first, size_t last) const noexcept {
+  return const_segment_view(deque_, offset_ + first, offset_ + last);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void Deque<T, Allocator, ChunkPolicy>::for_each_segment(Func&& func) {
+  for_each_segment(0, size_, std::forward<Func>(func));
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void Deque<T, Allocator, ChunkPolicy>::for_each_segment(Func&& func) const {
+  for_each_segment(0, size_, std::forward<Func>(func));
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void Deque<T, Allocator, ChunkPolicy>::for_each_segment(size_t first, size_t last, Func&& func) {
+  for (segment chunk: segments(first, last)) {
+    func(chunk);
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void Deque<T, Allocator, ChunkPolicy>::for_each_segment(size_t first, size_t last, Func&& func) const {
+  for (const_segment chunk: segments(first, last)) {
+    func(chunk);
+  }
+}
+
+// caches the bounds of the current chunk, so stepping inside a chunk is a single compare
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-class Deque<T>::CommonIterator {
+class Deque<T, Allocator, ChunkPolicy>::CommonIterator {
  private:
-  T** ptr_;
-  size_t index_;
+  // a position is its node and the index inside that chunk; first_ caches *node_, which is null for a chunk
+  // not allocated yet, so no pointer into a missing chunk is ever formed
+  T** node_ = nullptr;
+  T* first_ = nullptr;
+  size_t index_ = 0;
+
+  void set_node(T**) noexcept;
 
  public:
   CommonIterator() = default;
 
-  CommonIterator(T** ptr, size_t index) : ptr_(ptr), index_(index) {}
+  CommonIterator(T** node, size_t index) noexcept;
 
   using value_type = T;
   using iterator_category = std::random_access_iterator_tag;
@@ -336,212 +1566,334 @@ class Deque<T>::CommonIterator {
   using reference = typename std::conditional<is_const, const T&, T&>::type;
   using pointer = typename std::conditional<is_const, const T*, T*>::type;
 
-  operator CommonIterator<true>() const;
+  operator CommonIterator<true>() const noexcept;
 
   const CommonIterator<is_const> operator--(int) noexcept;
   const CommonIterator<is_const> operator++(int) noexcept;
   CommonIterator<is_const>& operator--() noexcept;
   CommonIterator<is_const>& operator++() noexcept;
-  CommonIterator<is_const>& operator+=(ssize_t) noexcept;
-  CommonIterator<is_const>& operator-=(ssize_t) noexcept;
-  CommonIterator<is_const> operator+(ssize_t) const noexcept;
-  CommonIterator<is_const> operator-(ssize_t) const noexcept;
+  CommonIterator<is_const>& operator+=(difference_type) noexcept;
+  CommonIterator<is_const>& operator-=(difference_type) noexcept;
+  CommonIterator<is_const> operator+(difference_type) const noexcept;
+  CommonIterator<is_const> operator-(difference_type) const noexcept;
 
   reference operator*() const;
   pointer operator->() const;
+  reference operator[](difference_type) const;
 
-  size_t operator-(CommonIterator<is_const>) noexcept;
-  bool operator<(CommonIterator<is_const>) noexcept;
-  bool operator==(CommonIterator<is_const>) noexcept;
-  bool operator>(CommonIterator<is_const>) noexcept;
-  bool operator<=(CommonIterator<is_const>) noexcept;
-  bool operator>=(CommonIterator<is_const>) noexcept;
-  bool operator!=(CommonIterator<is_const>) noexcept;
+  difference_type operator-(const CommonIterator<is_const>&) const noexcept;
+  bool operator<(const CommonIterator<is_const>&) const noexcept;
+  bool operator==(const CommonIterator<is_const>&) const noexcept;
+  bool operator>(const CommonIterator<is_const>&) const noexcept;
+  bool operator<=(const CommonIterator<is_const>&) const noexcept;
+  bool operator>=(const CommonIterator<is_const>&) const noexcept;
+  bool operator!=(const CommonIterator<is_const>&) const noexcept;
 
   T* get_array() const;
   T** get_ptr() const;
   size_t get_index() const;
 };
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::CommonIterator(T** node, size_t index) noexcept : index_(index) {
+  set_node(node);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-Deque<T>::CommonIterator<is_const>::operator CommonIterator<true>() const {
-  return CommonIterator<true>(ptr_, index_);
+void Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::set_node(T** node) noexcept {
+  node_ = node;
+  first_ = *node;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-const typename Deque<T>::template CommonIterator<is_const>
-Deque<T>::CommonIterator<is_const>::operator--(int) noexcept {
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
+  return CommonIterator<true>(node_, index_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+const typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator--(int) noexcept {
   CommonIterator temp_iterator(*this);
   --(*this);
   return temp_iterator;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-const typename Deque<T>::template CommonIterator<is_const>
-Deque<T>::CommonIterator<is_const>::operator++(int) noexcept {
+const typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator++(int) noexcept {
   CommonIterator temp_iterator(*this);
   ++(*this);
   return temp_iterator;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>&
-Deque<T>::CommonIterator<is_const>::operator--() noexcept {
-  (*this) -= 1;
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator--() noexcept {
+  if (index_ == 0) {
+    set_node(node_ - 1);
+    index_ = MAX_SIZE_;
+  }
+  --index_;
   return *this;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>&
-Deque<T>::CommonIterator<is_const>::operator++() noexcept {
-  (*this) += 1;
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator++() noexcept {
+  if (++index_ == MAX_SIZE_) {
+    set_node(node_ + 1);
+    index_ = 0;
+  }
   return *this;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>&
-Deque<T>::CommonIterator<is_const>::operator+=(ssize_t val) noexcept {
-  if (val < 0) {
-    return (*this) -= (-val);
-  } else {
-    if (index_ + val < MAX_SIZE_) {
-      index_ += val;
-    } else {
-      ptr_ += (val - (MAX_SIZE_ - index_)) / MAX_SIZE_ + 1;
-      index_ = (val - (MAX_SIZE_ - index_)) % MAX_SIZE_;
-    }
-    return *this;
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator+=(difference_type val) noexcept {
+  difference_type position = difference_type(index_) + val;
+  if (position < 0 || position >= difference_type(MAX_SIZE_)) {
+    // floor division by a power of two, also for negative positions
+    difference_type node_shift = position >= 0 ? position >> SHIFT_ : -((-position - 1) >> SHIFT_) - 1;
+    set_node(node_ + node_shift);
   }
+  index_ = size_t(position) & MASK_;
+  return *this;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>&
-Deque<T>::CommonIterator<is_const>::operator-=(ssize_t val) noexcept {
-  if (val < 0) {
-    return (*this) += (-val);
-  } else {
-    if (index_ >= size_t(val)) {
-      index_ -= val;
-    } else {
-      ptr_ -= (val - index_ - 1) / MAX_SIZE_ + 1;
-      index_ = (MAX_SIZE_ - (val - index_) % MAX_SIZE_) % MAX_SIZE_;
-    }
-    return *this;
-  }
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator-=(difference_type val) noexcept {
+  return (*this) += (-val);
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>
-Deque<T>::CommonIterator<is_const>::operator+(ssize_t val) const noexcept {
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator+(difference_type val) const noexcept {
   CommonIterator temp_iterator(*this);
   temp_iterator += val;
   return temp_iterator;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>
-Deque<T>::CommonIterator<is_const>::operator-(ssize_t val) const noexcept {
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator-(difference_type val) const noexcept {
   return (*this) + (-val);
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>::reference
-Deque<T>::CommonIterator<is_const>::operator*() const {
-  return (*ptr_)[index_];
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>::reference
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator*() const {
+  return first_[index_];
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-typename Deque<T>::template CommonIterator<is_const>::pointer
-Deque<T>::CommonIterator<is_const>::operator->() const {
-  return &(operator*());
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>::pointer
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator->() const {
+  return first_ + index_;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-size_t
-Deque<T>::CommonIterator<is_const>::operator-(typename Deque<T>::template CommonIterator<is_const> arg_it) noexcept {
-  if (*this < arg_it) {
-    return -(arg_it - *this);
-  } else {
-    size_t level_difference = (ptr_ != arg_it.ptr_) ?
-                              std::abs(arg_it.ptr_ - ptr_) - 1 : 0;
-    if (ptr_ == arg_it.ptr_) {
-      return index_ - arg_it.index_;
-    } else {
-      return Deque<T>::MAX_SIZE_ - arg_it.index_ +
-             level_difference * Deque<T>::MAX_SIZE_ + index_;
-    }
-  }
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>::reference
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator[](difference_type val) const {
+  return *((*this) + val);
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-bool
-Deque<T>::CommonIterator<is_const>::operator<(typename Deque<T>::template CommonIterator<is_const> arg_it) noexcept {
-  return (ptr_ < arg_it.ptr_ ||
-          (ptr_ == arg_it.ptr_ && index_ < arg_it.index_));
+typename Deque<T, Allocator, ChunkPolicy>::template CommonIterator<is_const>::difference_type
+Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator-(const CommonIterator<is_const>& arg_it) const noexcept {
+  return (node_ - arg_it.node_) * difference_type(MAX_SIZE_) + difference_type(index_) - difference_type(arg_it.index_);
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-bool
-Deque<T>::CommonIterator<is_const>::operator==(typename Deque<T>::template CommonIterator<is_const> arg_it) noexcept {
-  return (ptr_ == arg_it.ptr_ && index_ == arg_it.index_);
+bool Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator<(const CommonIterator<is_const>& arg_it) const noexcept {
+  return (node_ < arg_it.node_ || (node_ == arg_it.node_ && index_ < arg_it.index_));
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-bool
-Deque<T>::CommonIterator<is_const>::operator>(typename Deque<T>::template CommonIterator<is_const> arg_it) noexcept {
-  return !(*this < arg_it || *this == arg_it);
+bool Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator==(const CommonIterator<is_const>& arg_it) const noexcept {
+  return node_ == arg_it.node_ && index_ == arg_it.index_;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-bool
-Deque<T>::CommonIterator<is_const>::operator<=(typename Deque<T>::template CommonIterator<is_const> arg_it) noexcept {
-  return (*this < arg_it || *this == arg_it);
+bool Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator>(const CommonIterator<is_const>& arg_it) const noexcept {
+  return arg_it < *this;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-bool
-Deque<T>::CommonIterator<is_const>::operator>=(typename Deque<T>::template CommonIterator<is_const> arg_it) noexcept {
+bool Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator<=(const CommonIterator<is_const>& arg_it) const noexcept {
+  return !(arg_it < *this);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator>=(const CommonIterator<is_const>& arg_it) const noexcept {
   return !(*this < arg_it);
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-bool
-Deque<T>::CommonIterator<is_const>::operator!=(typename Deque<T>::template CommonIterator<is_const> arg_it) noexcept {
+bool Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator!=(const CommonIterator<is_const>& arg_it) const noexcept {
   return !(*this == arg_it);
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-T* Deque<T>::CommonIterator<is_const>::get_array() const {
-  return *ptr_;
+T* Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::get_array() const {
+  return first_;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-T** Deque<T>::CommonIterator<is_const>::get_ptr() const {
-  return ptr_;
+T** Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::get_ptr() const {
+  return node_;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename ChunkPolicy>
 template<bool is_const>
-size_t Deque<T>::CommonIterator<is_const>::get_index() const {
+size_t Deque<T, Allocator, ChunkPolicy>::CommonIterator<is_const>::get_index() const {
   return index_;
-}
\ No newline at end of file
+}
+
+// walks the global slots [position_, last_) one chunk at a time, the first and the last span may be partial
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+class Deque<T, Allocator, ChunkPolicy>::CommonSegmentIterator {
+ private:
+  T* const* map_ = nullptr;
+  size_t position_ = 0;
+  size_t last_ = 0;
+
+ public:
+  CommonSegmentIterator() = default;
+
+  CommonSegmentIterator(T* const* map, size_t position, size_t last) noexcept;
+
+  using value_type = typename std::conditional<is_const, const_segment, segment>::type;
+  using iterator_category = std::forward_iterator_tag;
+  using difference_type = ssize_t;
+  using reference = value_type;
+  using pointer = void;
+
+  value_type operator*() const noexcept;
+  CommonSegmentIterator<is_const>& operator++() noexcept;
+  CommonSegmentIterator<is_const> operator++(int) noexcept;
+
+  bool operator==(const CommonSegmentIterator<is_const>&) const noexcept;
+  bool operator!=(const CommonSegmentIterator<is_const>&) const noexcept;
+};
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::CommonSegmentIterator(T* const* map, size_t position,
+                                                                                           size_t last) noexcept
+    : map_(map), position_(position), last_(last) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename Deque<T, Allocator, ChunkPolicy>::template CommonSegmentIterator<is_const>::value_type
+Deque<T, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator*() const noexcept {
+  size_t chunk_end = (position_ | MASK_) + 1;
+  return value_type(map_[position_ >> SHIFT_] + (position_ & MASK_), std::min(chunk_end, last_) - position_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename Deque<T, Allocator, ChunkPolicy>::template CommonSegmentIterator<is_const>&
+Deque<T, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator++() noexcept {
+  position_ = std::min((position_ | MASK_) + 1, last_);
+  return *this;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename Deque<T, Allocator, ChunkPolicy>::template CommonSegmentIterator<is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator++(int) noexcept {
+  CommonSegmentIterator temp_iterator(*this);
+  ++(*this);
+  return temp_iterator;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool Deque<T, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator==(
+    const CommonSegmentIterator<is_const>& arg_it) const noexcept {
+  return position_ == arg_it.position_;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool Deque<T, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator!=(
+    const CommonSegmentIterator<is_const>& arg_it) const noexcept {
+  return !(*this == arg_it);
+}
+
+// contiguous pieces of a slot range, valid until the next insertion or erasure
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+class Deque<T, Allocator, ChunkPolicy>::CommonSegmentView {
+ private:
+  T* const* map_;
+  size_t first_;
+  size_t last_;
+
+ public:
+  CommonSegmentView(T* const* map, size_t first, size_t last) noexcept;
+
+  using iterator = CommonSegmentIterator<is_const>;
+
+  iterator begin() const noexcept;
+  iterator end() const noexcept;
+  size_t size() const noexcept;
+  bool empty() const noexcept;
+};
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+Deque<T, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::CommonSegmentView(T* const* map, size_t first,
+                                                                                   size_t last) noexcept
+    : map_(map), first_(first), last_(last) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename Deque<T, Allocator, ChunkPolicy>::template CommonSegmentView<is_const>::iterator
+Deque<T, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::begin() const noexcept {
+  return iterator(map_, first_, last_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename Deque<T, Allocator, ChunkPolicy>::template CommonSegmentView<is_const>::iterator
+Deque<T, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::end() const noexcept {
+  return iterator(map_, last_, last_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+size_t Deque<T, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::size() const noexcept {
+  return first_ == last_ ? 0 : ((last_ - 1) >> SHIFT_) - (first_ >> SHIFT_) + 1;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool Deque<T, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::empty() const noexcept {
+  return first_ == last_;
+}
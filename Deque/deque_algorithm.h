@@ -0,0 +1,589 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <type_traits>
+
+#include "deque.h"
+
+// algorithms that run over the contiguous chunks of a Deque instead of stepping an iterator;
+// integral and floating point T get vector kernels (AVX2 when the cpu has it, SSE otherwise)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DEQUE_SIMD 1
+#endif
+
+namespace deque_simd {
+
+template<typename T>
+constexpr bool is_integral_lane_v = std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                    (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+template<typename T>
+constexpr bool is_arithmetic_lane_v = is_integral_lane_v<T> || std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+// integer sums are taken in the unsigned type of the same width, where wraparound is defined
+template<typename T, bool = std::is_integral_v<T>>
+struct Accumulator {
+  using type = T;
+};
+
+template<typename T>
+struct Accumulator<T, true> {
+  using type = std::make_unsigned_t<T>;
+};
+
+#ifdef DEQUE_SIMD
+
+template<typename T, size_t Bytes>
+struct Vector {
+  typedef T type __attribute__((vector_size(Bytes)));
+  static constexpr size_t LANES = Bytes / sizeof(T);
+};
+
+inline bool has_avx2() noexcept {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+}
+
+// vectors are passed by reference, a 32-byte vector by value would depend on whether AVX is enabled
+template<typename V>
+[[gnu::always_inline]] inline void load(V& vector, const void* ptr) noexcept {
+  std::memcpy(&vector, ptr, sizeof(V));
+}
+
+template<typename Mask>
+[[gnu::always_inline]] inline bool any(const Mask& mask) noexcept {
+  using Words = typename Vector<long long, sizeof(Mask)>::type;
+  Words words = reinterpret_cast<Words>(mask);
+  long long result = 0;
+  for (size_t i = 0; i < sizeof(Mask) / sizeof(long long); ++i) {
+    result |= words[i];
+  }
+  return result != 0;
+}
+
+template<typename T, size_t Bytes>
+[[gnu::always_inline]] inline size_t find_kernel(const T* data, size_t count, T value) noexcept {
+  using V = typename Vector<T, Bytes>::type;
+  constexpr size_t LANES = Vector<T, Bytes>::LANES;
+  V needle = value - V{};
+  V block;
+  size_t i = 0;
+  for (; i + LANES <= count; i += LANES) {
+    load(block, data + i);
+    if (any(block == needle)) {
+      break;
+    }
+  }
+  for (; i < count && data[i] != value; ++i) {}
+  return i;
+}
+
+template<typename T, size_t Bytes>
+[[gnu::always_inline]] inline size_t count_kernel(const T* data, size_t count, T value) noexcept {
+  using V = typename Vector<T, Bytes>::type;
+  using Mask = decltype(V{} == V{});
+  using Lane = std::remove_reference_t<decltype(Mask{}[0])>;
+  constexpr size_t LANES = Vector<T, Bytes>::LANES;
+  // matches are collected as -1 lanes, flushed before an 8-bit lane can overflow
+  constexpr size_t FLUSH = 127;
+  V needle = value - V{};
+  V block;
+  size_t result = 0;
+  size_t i = 0;
+  while (i + LANES <= count) {
+    Mask matches{};
+    for (size_t step = 0; step < FLUSH && i + LANES <= count; ++step, i += LANES) {
+      load(block, data + i);
+      matches += (block == needle);
+    }
+    for (size_t lane = 0; lane < LANES; ++lane) {
+      result -= Lane(matches[lane]);
+    }
+  }
+  for (; i < count; ++i) {
+    result += (data[i] == value);
+  }
+  return result;
+}
+
+// floating point sums are reassociated across the lanes
+template<typename T, size_t Bytes>
+[[gnu::always_inline]] inline T sum_kernel(const T* data, size_t count) noexcept {
+  using V = typename Vector<T, Bytes>::type;
+  constexpr size_t LANES = Vector<T, Bytes>::LANES;
+  V first{};
+  V second{};
+  V block;
+  size_t i = 0;
+  for (; i + 2 * LANES <= count; i += 2 * LANES) {
+    load(block, data + i);
+    first += block;
+    load(block, data + i + LANES);
+    second += block;
+  }
+  first += second;
+  T result{};
+  for (size_t lane = 0; lane < LANES; ++lane) {
+    result += first[lane];
+  }
+  for (; i < count; ++i) {
+    result += data[i];
+  }
+  return result;
+}
+
+template<bool is_min, typename Value>
+[[gnu::always_inline]] inline void pick(Value& best, const Value& candidate) noexcept {
+  if constexpr (is_min) {
+    best = candidate < best ? candidate : best;
+  } else {
+    best = best < candidate ? candidate : best;
+  }
+}
+
+template<typename T, size_t Bytes, bool is_min>
+[[gnu::always_inline]] inline T extreme_kernel(const T* data, size_t count) noexcept {
+  using V = typename Vector<T, Bytes>::type;
+  constexpr size_t LANES = Vector<T, Bytes>::LANES;
+  T result = data[0];
+  size_t i = 0;
+  if (count >= LANES) {
+    V best;
+    V block;
+    load(best, data);
+    for (i = LANES; i + LANES <= count; i += LANES) {
+      load(block, data + i);
+      pick<is_min>(best, block);
+    }
+    for (size_t lane = 0; lane < LANES; ++lane) {
+      pick<is_min>(result, T(best[lane]));
+    }
+  }
+  for (; i < count; ++i) {
+    pick<is_min>(result, data[i]);
+  }
+  return result;
+}
+
+template<typename T, size_t Bytes>
+[[gnu::always_inline]] inline size_t mismatch_kernel(const T* left, const T* right, size_t count) noexcept {
+  using V = typename Vector<T, Bytes>::type;
+  constexpr size_t LANES = Vector<T, Bytes>::LANES;
+  V left_block;
+  V right_block;
+  size_t i = 0;
+  for (; i + LANES <= count; i += LANES) {
+    load(left_block, left + i);
+    load(right_block, right + i);
+    if (any(left_block != right_block)) {
+      break;
+    }
+  }
+  for (; i < count && left[i] == right[i]; ++i) {}
+  return i;
+}
+
+// 8 x 32-bit lanes on every cpu, so the hash does not depend on the instruction set
+using HashLanes = Vector<uint32_t, 32>::type;
+constexpr size_t HASH_STRIPE = sizeof(HashLanes);
+
+[[gnu::always_inline]] inline void hash_kernel(HashLanes& lanes, const unsigned char* data, size_t stripes) noexcept {
+  HashLanes state = lanes;
+  HashLanes block;
+  for (size_t i = 0; i < stripes; ++i) {
+    load(block, data + i * HASH_STRIPE);
+    state ^= block;
+    state = ((state << 13) | (state >> 19)) * 0x9E3779B1u;
+  }
+  lanes = state;
+}
+
+template<typename T>
+[[gnu::target("avx2")]] size_t find_avx2(const T* data, size_t count, T value) noexcept {
+  return find_kernel<T, 32>(data, count, value);
+}
+
+template<typename T>
+[[gnu::target("avx2")]] size_t count_avx2(const T* data, size_t count, T value) noexcept {
+  return count_kernel<T, 32>(data, count, value);
+}
+
+template<typename T>
+[[gnu::target("avx2")]] T sum_avx2(const T* data, size_t count) noexcept {
+  return sum_kernel<T, 32>(data, count);
+}
+
+template<typename T, bool is_min>
+[[gnu::target("avx2")]] T extreme_avx2(const T* data, size_t count) noexcept {
+  return extreme_kernel<T, 32, is_min>(data, count);
+}
+
+template<typename T>
+[[gnu::target("avx2")]] size_t mismatch_avx2(const T* left, const T* right, size_t count) noexcept {
+  return mismatch_kernel<T, 32>(left, right, count);
+}
+
+[[gnu::target("avx2")]] inline void hash_avx2(HashLanes& lanes, const unsigned char* data, size_t stripes) noexcept {
+  hash_kernel(lanes, data, stripes);
+}
+
+template<typename T>
+size_t find(const T* data, size_t count, T value) noexcept {
+  return has_avx2() ? find_avx2(data, count, value) : find_kernel<T, 16>(data, count, value);
+}
+
+template<typename T>
+size_t count(const T* data, size_t count, T value) noexcept {
+  return has_avx2() ? count_avx2(data, count, value) : count_kernel<T, 16>(data, count, value);
+}
+
+template<typename T>
+T sum(const T* data, size_t count) noexcept {
+  using U = typename Accumulator<T>::type;
+  const U* lanes = reinterpret_cast<const U*>(data);
+  return T(has_avx2() ? sum_avx2(lanes, count) : sum_kernel<U, 16>(lanes, count));
+}
+
+// smallest (is_min) or largest element of a non-empty array
+template<bool is_min, typename T>
+T extreme(const T* data, size_t count) noexcept {
+  return has_avx2() ? extreme_avx2<T, is_min>(data, count) : extreme_kernel<T, 16, is_min>(data, count);
+}
+
+template<typename T>
+size_t mismatch(const T* left, const T* right, size_t count) noexcept {
+  return has_avx2() ? mismatch_avx2(left, right, count) : mismatch_kernel<T, 16>(left, right, count);
+}
+
+inline void hash(HashLanes& lanes, const unsigned char* data, size_t stripes) noexcept {
+  if (has_avx2()) {
+    hash_avx2(lanes, data, stripes);
+  } else {
+    hash_kernel(lanes, data, stripes);
+  }
+}
+
+#else
+
+template<typename T>
+size_t find(const T* data, size_t count, T value) noexcept {
+  return std::find(data, data + count, value) - data;
+}
+
+template<typename T>
+size_t count(const T* data, size_t count, T value) noexcept {
+  return std::count(data, data + count, value);
+}
+
+template<typename T>
+T sum(const T* data, size_t count) noexcept {
+  typename Accumulator<T>::type result{};
+  for (size_t i = 0; i < count; ++i) {
+    result += data[i];
+  }
+  return T(result);
+}
+
+template<bool is_min, typename T>
+T extreme(const T* data, size_t count) noexcept {
+  return is_min ? *std::min_element(data, data + count) : *std::max_element(data, data + count);
+}
+
+template<typename T>
+size_t mismatch(const T* left, const T* right, size_t count) noexcept {
+  return std::mismatch(left, left + count, right).first - left;
+}
+
+struct HashLanes {
+  uint32_t lanes[8];
+
+  uint32_t& operator[](size_t i) noexcept {
+    return lanes[i];
+  }
+};
+constexpr size_t HASH_STRIPE = 32;
+
+inline void hash(HashLanes& lanes, const unsigned char* data, size_t stripes) noexcept {
+  for (size_t i = 0; i < stripes; ++i) {
+    for (size_t lane = 0; lane < 8; ++lane) {
+      uint32_t word;
+      std::memcpy(&word, data + i * HASH_STRIPE + lane * sizeof(word), sizeof(word));
+      uint32_t state = lanes[lane] ^ word;
+      lanes[lane] = ((state << 13) | (state >> 19)) * 0x9E3779B1u;
+    }
+  }
+}
+
+#endif
+
+// feeds bytes in 32-byte stripes, carrying the tail of one chunk over to the next
+class StreamHasher {
+ private:
+  HashLanes lanes_{};
+  unsigned char tail_[HASH_STRIPE];
+  size_t tail_size_ = 0;
+  uint64_t length_ = 0;
+
+ public:
+  StreamHasher() noexcept {
+    for (size_t lane = 0; lane < 8; ++lane) {
+      lanes_[lane] = 0x85EBCA77u * uint32_t(lane + 1);
+    }
+  }
+
+  void feed(const unsigned char* data, size_t count) noexcept {
+    length_ += count;
+    if (tail_size_ > 0) {
+      size_t taken = std::min(count, HASH_STRIPE - tail_size_);
+      std::memcpy(tail_ + tail_size_, data, taken);
+      tail_size_ += taken;
+      data += taken;
+      count -= taken;
+      if (tail_size_ < HASH_STRIPE) {
+        return;
+      }
+      hash(lanes_, tail_, 1);
+      tail_size_ = 0;
+    }
+    hash(lanes_, data, count / HASH_STRIPE);
+    std::memcpy(tail_, data + count / HASH_STRIPE * HASH_STRIPE, count % HASH_STRIPE);
+    tail_size_ = count % HASH_STRIPE;
+  }
+
+  uint64_t finish() noexcept {
+    uint64_t result = length_;
+    for (size_t i = 0; i < tail_size_; ++i) {
+      result = (result ^ tail_[i]) * 0x100000001B3ull;
+    }
+    for (size_t lane = 0; lane < 8; ++lane) {
+      result = (result ^ lanes_[lane]) * 0x9E3779B97F4A7C15ull;
+      result ^= result >> 29;
+    }
+    result ^= result >> 33;
+    result *= 0xFF51AFD7ED558CCDull;
+    result ^= result >> 33;
+    return result;
+  }
+};
+
+// calls func(left_piece, right_piece) on equally long contiguous pieces of two ranges until it returns false
+template<typename LeftView, typename RightView, typename Func>
+void for_each_segment_pair(const LeftView& left, const RightView& right, Func&& func) {
+  auto left_it = left.begin();
+  auto right_it = right.begin();
+  if (left_it == left.end() || right_it == right.end()) {
+    return;
+  }
+  auto left_piece = *left_it;
+  auto right_piece = *right_it;
+  while (true) {
+    size_t length = std::min(left_piece.size(), right_piece.size());
+    if (!func(left_piece.first(length), right_piece.first(length))) {
+      return;
+    }
+    left_piece = left_piece.subspan(length);
+    right_piece = right_piece.subspan(length);
+    if (left_piece.empty() && ++left_it == left.end()) {
+      return;
+    }
+    if (right_piece.empty() && ++right_it == right.end()) {
+      return;
+    }
+    if (left_piece.empty()) {
+      left_piece = *left_it;
+    }
+    if (right_piece.empty()) {
+      right_piece = *right_it;
+    }
+  }
+}
+
+} // namespace deque_simd
+
+// index of the first element equal to value, or size() if there is none
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t deque_find(const Deque<T, Allocator, ChunkPolicy>& deque, const T& value) {
+  size_t index = 0;
+  for (auto segment: deque.segments()) {
+    size_t found;
+    if constexpr (deque_simd::is_integral_lane_v<T>) {
+      found = deque_simd::find(segment.data(), segment.size(), value);
+    } else {
+      found = std::find(segment.begin(), segment.end(), value) - segment.begin();
+    }
+    index += found;
+    if (found != segment.size()) {
+      break;
+    }
+  }
+  return index;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t deque_count(const Deque<T, Allocator, ChunkPolicy>& deque, const T& value) {
+  size_t result = 0;
+  deque.for_each_segment([&](std::span<const T> segment) {
+    if constexpr (deque_simd::is_integral_lane_v<T>) {
+      result += deque_simd::count(segment.data(), segment.size(), value);
+    } else {
+      result += std::count(segment.begin(), segment.end(), value);
+    }
+  });
+  return result;
+}
+
+// vector lanes accumulate in T, so a wider Result is summed element by element. with Result = T an integer
+// sum wraps around on overflow
+template<typename T, typename Allocator, typename ChunkPolicy, typename Result = T>
+Result deque_sum(const Deque<T, Allocator, ChunkPolicy>& deque, Result init = Result()) {
+  using U = typename deque_simd::Accumulator<T>::type;
+  deque.for_each_segment([&](std::span<const T> segment) {
+    if constexpr (deque_simd::is_arithmetic_lane_v<T> && std::is_same_v<T, Result>) {
+      init = Result(U(init) + U(deque_simd::sum(segment.data(), segment.size())));
+    } else {
+      for (const T& element: segment) {
+        init += element;
+      }
+    }
+  });
+  return init;
+}
+
+// index of the first smallest element, or size() for an empty deque
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t deque_min_element(const Deque<T, Allocator, ChunkPolicy>& deque) {
+  if (deque.size() == 0) {
+    return 0;
+  }
+  if constexpr (deque_simd::is_integral_lane_v<T>) {
+    T result = deque.front();
+    deque.for_each_segment([&](std::span<const T> segment) {
+      result = std::min(result, deque_simd::extreme<true>(segment.data(), segment.size()));
+    });
+    return deque_find(deque, result);
+  } else {
+    return std::min_element(deque.begin(), deque.end()) - deque.begin();
+  }
+}
+
+// index of the first largest element, or size() for an empty deque
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t deque_max_element(const Deque<T, Allocator, ChunkPolicy>& deque) {
+  if (deque.size() == 0) {
+    return 0;
+  }
+  if constexpr (deque_simd::is_integral_lane_v<T>) {
+    T result = deque.front();
+    deque.for_each_segment([&](std::span<const T> segment) {
+      result = std::max(result, deque_simd::extreme<false>(segment.data(), segment.size()));
+    });
+    return deque_find(deque, result);
+  } else {
+    return std::max_element(deque.begin(), deque.end()) - deque.begin();
+  }
+}
+
+// std::fill_n already turns into memset or vector stores on a contiguous chunk
+template<typename T, typename Allocator, typename ChunkPolicy>
+void deque_fill(Deque<T, Allocator, ChunkPolicy>& deque, const T& value) {
+  deque.for_each_segment([&](std::span<T> segment) {
+    std::fill_n(segment.data(), segment.size(), value);
+  });
+}
+
+template<typename T, typename LeftAllocator, typename LeftPolicy, typename RightAllocator, typename RightPolicy>
+bool deque_equal(const Deque<T, LeftAllocator, LeftPolicy>& left, const Deque<T, RightAllocator, RightPolicy>& right) {
+  if (left.size() != right.size()) {
+    return false;
+  }
+  bool equal = true;
+  deque_simd::for_each_segment_pair(left.segments(), right.segments(), [&](auto left_piece, auto right_piece) {
+    if constexpr (deque_simd::is_integral_lane_v<T>) {
+      equal = deque_simd::mismatch(left_piece.data(), right_piece.data(), left_piece.size()) == left_piece.size();
+    } else {
+      equal = std::equal(left_piece.begin(), left_piece.end(), right_piece.begin());
+    }
+    return equal;
+  });
+  return equal;
+}
+
+template<typename T, typename LeftAllocator, typename LeftPolicy, typename RightAllocator, typename RightPolicy>
+bool deque_lexicographical_compare(const Deque<T, LeftAllocator, LeftPolicy>& left,
+                                   const Deque<T, RightAllocator, RightPolicy>& right) {
+  int order = 0;
+  deque_simd::for_each_segment_pair(left.segments(), right.segments(), [&](auto left_piece, auto right_piece) {
+    // elements that differ but are equivalent do not decide the order, the scan goes on past them
+    for (size_t index = 0;; ++index) {
+      if constexpr (deque_simd::is_integral_lane_v<T>) {
+        index += deque_simd::mismatch(left_piece.data() + index, right_piece.data() + index, left_piece.size() - index);
+      } else {
+        index = std::mismatch(left_piece.begin() + index, left_piece.end(), right_piece.begin() + index).first -
+                left_piece.begin();
+      }
+      if (index == left_piece.size()) {
+        return true;
+      }
+      if (left_piece[index] < right_piece[index] || right_piece[index] < left_piece[index]) {
+        order = (left_piece[index] < right_piece[index]) ? -1 : 1;
+        return false;
+      }
+    }
+  });
+  return order < 0 || (order == 0 && left.size() < right.size());
+}
+
+// elements without padding are hashed as raw bytes, anything else through std::hash
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t deque_hash(const Deque<T, Allocator, ChunkPolicy>& deque) {
+  if constexpr (std::has_unique_object_representations_v<T>) {
+    deque_simd::StreamHasher hasher;
+    deque.for_each_segment([&](std::span<const T> segment) {
+      hasher.feed(reinterpret_cast<const unsigned char*>(segment.data()), segment.size_bytes());
+    });
+    return hasher.finish();
+  } else {
+    size_t result = deque.size();
+    for (const T& element: deque) {
+      result ^= std::hash<T>()(element) + 0x9E3779B97F4A7C15ull + (result << 6) + (result >> 2);
+    }
+    return result;
+  }
+}
+
+// binary search over the first elements of the chunks, then inside the one chunk that can hold the answer
+template<typename T, typename Allocator, typename ChunkPolicy, typename Compare = std::less<>>
+size_t deque_lower_bound(const Deque<T, Allocator, ChunkPolicy>& deque, const T& value, Compare comp = Compare()) {
+  if (deque.size() == 0) {
+    return 0;
+  }
+  const size_t chunk = ChunkPolicy::template chunk_size<T>();
+  const size_t first_length = (*deque.segments().begin()).size();
+  const size_t segment_count = deque.segments().size();
+  auto segment_start = [&](size_t segment) {
+    return segment == 0 ? 0 : first_length + (segment - 1) * chunk;
+  };
+
+  // the last segment whose first element is still less than value
+  size_t low = 0;
+  size_t high = segment_count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (comp(deque[segment_start(middle)], value)) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0) {
+    return 0;
+  }
+  size_t start = segment_start(low - 1);
+  std::span<const T> segment = *deque.segments(start, std::min(start + chunk, deque.size())).begin();
+  return start + (std::lower_bound(segment.begin(), segment.end(), value, comp) - segment.begin());
+}
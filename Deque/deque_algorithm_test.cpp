@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "deque_algorithm.h"
+
+template<typename T, typename ChunkPolicy>
+Deque<T, std::allocator<T>, ChunkPolicy> MakeDeque(const std::vector<T>& values, size_t front_count) {
+  Deque<T, std::allocator<T>, ChunkPolicy> d;
+  for (size_t i = front_count; i < values.size(); ++i) {
+    d.push_back(values[i]);
+  }
+  for (size_t i = front_count; i > 0; --i) {
+    d.push_front(values[i - 1]);
+  }
+  return d;
+}
+
+template<typename T, typename ChunkPolicy>
+void CheckAlgorithms(size_t count, size_t front_count, int modulo) {
+  std::mt19937 gen(count + front_count);
+  std::vector<T> values(count);
+  for (auto& value: values) {
+    value = T(int(gen() % modulo) - modulo / 3);
+  }
+  auto d = MakeDeque<T, ChunkPolicy>(values, front_count);
+
+  for (int probe = -modulo / 3; probe < modulo; probe += 7) {
+    T value = T(probe);
+    assert(deque_find(d, value) == size_t(std::find(values.begin(), values.end(), value) - values.begin()));
+    assert(deque_count(d, value) == size_t(std::count(values.begin(), values.end(), value)));
+  }
+  assert(deque_sum(d) == std::accumulate(values.begin(), values.end(), T()));
+  assert(deque_sum(d, 0.0) == std::accumulate(values.begin(), values.end(), 0.0));
+  if (count > 0) {
+    assert(deque_min_element(d) == size_t(std::min_element(values.begin(), values.end()) - values.begin()));
+    assert(deque_max_element(d) == size_t(std::max_element(values.begin(), values.end()) - values.begin()));
+  }
+
+  // the same contents in a differently aligned deque
+  auto shifted = MakeDeque<T, FixedChunkPolicy<16>>(values, 0);
+  assert(deque_equal(d, shifted) && deque_equal(shifted, d));
+  assert(deque_hash(d) == deque_hash(shifted));
+  assert(!deque_lexicographical_compare(d, shifted) && !deque_lexicographical_compare(shifted, d));
+  if (count > 0) {
+    shifted[count / 2] = shifted[count / 2] + T(1);
+    assert(!deque_equal(d, shifted));
+    assert(deque_hash(d) != deque_hash(shifted));
+    assert(deque_lexicographical_compare(d, shifted) && !deque_lexicographical_compare(shifted, d));
+    shifted.pop_back();
+    assert(deque_lexicographical_compare(shifted, d) == (count / 2 == count - 1));
+  }
+
+  std::sort(values.begin(), values.end());
+  auto sorted = MakeDeque<T, ChunkPolicy>(values, front_count);
+  for (int probe = -modulo / 2; probe < modulo; probe += 5) {
+    T value = T(probe);
+    assert(deque_lower_bound(sorted, value) ==
+           size_t(std::lower_bound(values.begin(), values.end(), value) - values.begin()));
+  }
+
+  deque_fill(d, T(3));
+  assert(deque_count(d, T(3)) == count);
+}
+
+template<typename ChunkPolicy>
+void CheckAllTypes(size_t count, size_t front_count) {
+  CheckAlgorithms<int8_t, ChunkPolicy>(count, front_count, 100);
+  CheckAlgorithms<uint16_t, ChunkPolicy>(count, front_count, 1000);
+  CheckAlgorithms<int, ChunkPolicy>(count, front_count, 1000);
+  CheckAlgorithms<int64_t, ChunkPolicy>(count, front_count, 100000);
+  CheckAlgorithms<float, ChunkPolicy>(count, front_count, 1000);
+  CheckAlgorithms<double, ChunkPolicy>(count, front_count, 1000);
+}
+
+void test1() {
+  for (size_t count: {0, 1, 7, 33, 500, 5000}) {
+    for (size_t front_count: {size_t(0), count / 3}) {
+      CheckAllTypes<SmallChunkPolicy>(count, front_count);
+      CheckAllTypes<FixedChunkPolicy<8>>(count, front_count);
+    }
+  }
+}
+
+void test2() {
+  // more than 127 matches per lane in one chunk
+  Deque<char, std::allocator<char>, PageChunkPolicy> d;
+  d.resize(100'000, 'a');
+  d[77'777] = 'b';
+  assert(deque_count(d, 'a') == 99'999);
+  assert(deque_find(d, 'b') == 77'777);
+  assert(deque_find(d, 'c') == d.size());
+
+  Deque<std::string> words;
+  for (const char* word: {"apple", "banana", "cherry", "date"}) {
+    words.push_back(word);
+  }
+  Deque<std::string> other = words;
+  assert(deque_find(words, std::string("cherry")) == 2);
+  assert(deque_count(words, std::string("date")) == 1);
+  assert(deque_sum(words, std::string()) == "applebananacherrydate");
+  assert(deque_min_element(words) == 0 && deque_max_element(words) == 3);
+  assert(deque_equal(words, other) && deque_hash(words) == deque_hash(other));
+  other.back() = "dates";
+  assert(deque_lexicographical_compare(words, other));
+  assert(deque_lower_bound(words, std::string("c")) == 2);
+
+  Deque<int> descending;
+  for (int i = 100; i > 0; --i) {
+    descending.push_back(i);
+  }
+  assert(deque_lower_bound(descending, 40, std::greater<>()) == 60);
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "deque.h"
+#include "thread_pool.h"
+
+// bulk Deque operations split by chunk across a ThreadPool; chunks never share memory,
+// so every task works on whole chunks of its own
+
+struct ParallelOptions {
+  size_t grain = 64 * 1024;          // elements per task, rounded up to whole chunks
+  size_t serial_cutoff = 256 * 1024; // smaller ranges run on the calling thread
+};
+
+namespace deque_parallel {
+
+// the segments of view with the position of each one counted from the start of the view
+template<typename Segment>
+struct Segments {
+  std::vector<Segment> spans;
+  std::vector<size_t> positions;
+  size_t longest = 1;
+};
+
+template<typename View>
+auto collect(const View& view) {
+  Segments<std::decay_t<decltype(*view.begin())>> result;
+  size_t position = 0;
+  for (auto segment: view) {
+    result.spans.push_back(segment);
+    result.positions.push_back(position);
+    result.longest = std::max(result.longest, segment.size());
+    position += segment.size();
+  }
+  return result;
+}
+
+// calls func(i) for every segment index i, whole segments per task
+template<typename Segment, typename Func>
+void run(ThreadPool& pool, const Segments<Segment>& segments, size_t total, const ParallelOptions& options,
+         Func&& func) {
+  size_t count = segments.spans.size();
+  size_t grain = total < options.serial_cutoff ? count
+                                               : std::max<size_t>(1, (options.grain + segments.longest - 1) /
+                                                                         segments.longest);
+  pool.parallel_for(0, count, grain, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      func(i);
+    }
+  });
+}
+
+// constructs count elements at the back of deque, construct(slots, position) filling one raw segment;
+// if any segment throws, the finished ones are destroyed again and the deque is left as it was
+template<typename T, typename Allocator, typename ChunkPolicy, typename Construct>
+void append(ThreadPool& pool, Deque<T, Allocator, ChunkPolicy>& deque, size_t count, const ParallelOptions& options,
+            Construct&& construct) {
+  deque.append_uninitialized(count, [&](auto view) {
+    auto segments = collect(view);
+    std::unique_ptr<bool[]> built(new bool[segments.spans.size()]());
+    try {
+      run(pool, segments, count, options, [&](size_t i) {
+        construct(segments.spans[i], segments.positions[i]);
+        built[i] = true;
+      });
+    } catch (...) {
+      Allocator allocator = deque.get_allocator();
+      for (size_t i = 0; i < segments.spans.size(); ++i) {
+        if (built[i]) {
+          for (T& element: segments.spans[i]) {
+            std::allocator_traits<Allocator>::destroy(allocator, std::addressof(element));
+          }
+        }
+      }
+      throw;
+    }
+  });
+}
+
+// constructs slots[i] from make(i) through allocator, destroying the prefix on an exception
+template<typename T, typename Allocator, typename Make>
+void construct_each(Allocator& allocator, std::span<T> slots, Make&& make) {
+  size_t i = 0;
+  try {
+    for (; i < slots.size(); ++i) {
+      std::allocator_traits<Allocator>::construct(allocator, slots.data() + i, make(i));
+    }
+  } catch (...) {
+    for (; i > 0; --i) {
+      std::allocator_traits<Allocator>::destroy(allocator, slots.data() + i - 1);
+    }
+    throw;
+  }
+}
+
+} // namespace deque_parallel
+
+// appends count copies of value, what Deque(count, value) does serially
+template<typename T, typename Allocator, typename ChunkPolicy>
+void deque_parallel_append_fill(ThreadPool& pool, Deque<T, Allocator, ChunkPolicy>& deque, size_t count,
+                                const T& value, const ParallelOptions& options = ParallelOptions()) {
+  deque_parallel::append(pool, deque, count, options, [&](std::span<T> slots, size_t) {
+    if constexpr (std::is_same_v<Allocator, std::allocator<T>>) {
+      std::uninitialized_fill_n(slots.data(), slots.size(), value);
+    } else {
+      Allocator allocator = deque.get_allocator();
+      deque_parallel::construct_each(allocator, slots, [&](size_t) -> const T& { return value; });
+    }
+  });
+}
+
+// appends copies of every element of source, what the copy constructor does serially
+template<typename T, typename Allocator, typename ChunkPolicy, typename SourceAllocator, typename SourcePolicy>
+void deque_parallel_append_copy(ThreadPool& pool, Deque<T, Allocator, ChunkPolicy>& deque,
+                                const Deque<T, SourceAllocator, SourcePolicy>& source,
+                                const ParallelOptions& options = ParallelOptions()) {
+  deque_parallel::append(pool, deque, source.size(), options, [&](std::span<T> slots, size_t position) {
+    if constexpr (std::is_same_v<Allocator, std::allocator<T>>) {
+      T* out = slots.data();
+      try {
+        for (auto piece: source.segments(position, position + slots.size())) {
+          std::uninitialized_copy(piece.begin(), piece.end(), out);
+          out += piece.size();
+        }
+      } catch (...) {
+        std::destroy(slots.data(), out);
+        throw;
+      }
+    } else {
+      Allocator allocator = deque.get_allocator();
+      deque_parallel::construct_each(allocator, slots, [&](size_t i) -> const T& { return source[position + i]; });
+    }
+  });
+}
+
+// destination[i] = op(source[i]); the sizes must match, and source and destination may be the same deque
+template<typename T, typename Allocator, typename ChunkPolicy, typename U, typename DestinationAllocator,
+         typename DestinationPolicy, typename UnaryOp>
+void deque_parallel_transform(ThreadPool& pool, const Deque<T, Allocator, ChunkPolicy>& source,
+                              Deque<U, DestinationAllocator, DestinationPolicy>& destination, UnaryOp op,
+                              const ParallelOptions& options = ParallelOptions()) {
+  if (source.size() != destination.size()) {
+    throw std::length_error("deque_parallel_transform: sizes differ");
+  }
+  auto segments = deque_parallel::collect(destination.segments());
+  deque_parallel::run(pool, segments, destination.size(), options, [&](size_t i) {
+    U* target = segments.spans[i].data();
+    size_t position = segments.positions[i];
+    for (auto piece: source.segments(position, position + segments.spans[i].size())) {
+      target = std::transform(piece.begin(), piece.end(), target, op);
+    }
+  });
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy, typename Func>
+void deque_parallel_for_each(ThreadPool& pool, Deque<T, Allocator, ChunkPolicy>& deque, Func func,
+                             const ParallelOptions& options = ParallelOptions()) {
+  auto segments = deque_parallel::collect(deque.segments());
+  deque_parallel::run(pool, segments, deque.size(), options, [&](size_t i) {
+    std::for_each(segments.spans[i].begin(), segments.spans[i].end(), func);
+  });
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy, typename Func>
+void deque_parallel_for_each(ThreadPool& pool, const Deque<T, Allocator, ChunkPolicy>& deque, Func func,
+                             const ParallelOptions& options = ParallelOptions()) {
+  auto segments = deque_parallel::collect(deque.segments());
+  deque_parallel::run(pool, segments, deque.size(), options, [&](size_t i) {
+    std::for_each(segments.spans[i].begin(), segments.spans[i].end(), func);
+  });
+}
+
+// Deque::sort with the chunk sorts and the merge pieces spread over pool
+template<typename T, typename Allocator, typename ChunkPolicy, typename Compare = std::less<>>
+void deque_parallel_sort(ThreadPool& pool, Deque<T, Allocator, ChunkPolicy>& deque, Compare comp = Compare(),
+                         const ParallelOptions& options = ParallelOptions()) {
+  if (deque.size() < options.serial_cutoff) {
+    deque.sort(comp);
+    return;
+  }
+  deque.sort(comp, pool.size() * 4, [&](size_t count, auto&& task) {
+    size_t grain = std::max<size_t>(1, count / (pool.size() * 8));
+    pool.parallel_for(0, count, grain, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        task(i);
+      }
+    });
+  });
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "deque_parallel.h"
+
+struct ThrowingCopy {
+  static std::atomic<int> alive;
+  static std::atomic<int> copies_left;
+
+  int x = 0;
+
+  ThrowingCopy(int x) : x(x) { ++alive; }
+  ThrowingCopy(const ThrowingCopy& other) : x(other.x) {
+    if (copies_left.fetch_sub(1) <= 0) {
+      throw std::runtime_error("copy failed");
+    }
+    ++alive;
+  }
+  ~ThrowingCopy() { --alive; }
+};
+
+std::atomic<int> ThrowingCopy::alive{0};
+std::atomic<int> ThrowingCopy::copies_left{0};
+
+template<typename ChunkPolicy>
+void CheckParallel(ThreadPool& pool, size_t count, const ParallelOptions& options) {
+  Deque<int, std::allocator<int>, ChunkPolicy> filled;
+  filled.push_back(-1);
+  filled.push_front(-2);
+  deque_parallel_append_fill(pool, filled, count, 7, options);
+  assert(filled.size() == count + 2);
+  assert(filled[0] == -2 && filled[1] == -1);
+  for (size_t i = 2; i < filled.size(); ++i) {
+    assert(filled[i] == 7);
+  }
+
+  deque_parallel_transform(pool, filled, filled, [](int x) { return x * 3; }, options);
+  Deque<long long, std::allocator<long long>, FixedChunkPolicy<16>> wide;
+  wide.resize(filled.size());
+  int index = 0;
+  deque_parallel_for_each(pool, filled, [](int& x) { ++x; }, options);
+  for (auto& x: filled) {
+    x += index++;
+  }
+  deque_parallel_transform(pool, filled, wide, [](int x) { return x * 1000LL; }, options);
+
+  // copies line up although source and destination have different chunk sizes and offsets
+  Deque<int, std::allocator<int>, FixedChunkPolicy<8>> copy;
+  copy.push_front(42);
+  deque_parallel_append_copy(pool, copy, filled, options);
+  assert(copy.size() == filled.size() + 1 && copy[0] == 42);
+  for (size_t i = 0; i < filled.size(); ++i) {
+    assert(copy[i + 1] == filled[i]);
+    assert(wide[i] == filled[i] * 1000LL);
+  }
+
+  std::atomic<long long> sum{0};
+  const auto& view = copy;
+  deque_parallel_for_each(pool, view, [&](const int& x) { sum.fetch_add(x, std::memory_order_relaxed); }, options);
+  long long expected = 0;
+  for (int x: copy) {
+    expected += x;
+  }
+  assert(sum.load() == expected);
+}
+
+void test1() {
+  ParallelOptions small_tasks{64, 0};
+  ParallelOptions defaults;
+  for (size_t threads: {1, 3}) {
+    ThreadPool pool(threads);
+    for (size_t count: {0, 1, 100, 10'000, 300'000}) {
+      CheckParallel<SmallChunkPolicy>(pool, count, small_tasks);
+      CheckParallel<FixedChunkPolicy<4>>(pool, count, small_tasks);
+      CheckParallel<SmallChunkPolicy>(pool, count, defaults);
+    }
+  }
+}
+
+void test2() {
+  ThreadPool pool(4);
+  ParallelOptions small_tasks{8, 0};
+
+  Deque<std::string> words;
+  deque_parallel_append_fill(pool, words, 5000, std::string(40, 'w'), small_tasks);
+  Deque<std::string, std::allocator<std::string>, FixedChunkPolicy<2>> copy;
+  deque_parallel_append_copy(pool, copy, words, small_tasks);
+  assert(copy.size() == 5000 && copy[4999] == std::string(40, 'w'));
+
+  // a failing copy leaves the deque and the element count as they were
+  ThrowingCopy::copies_left = 1'000'000;
+  Deque<ThrowingCopy, std::allocator<ThrowingCopy>, FixedChunkPolicy<4>> source;
+  for (int i = 0; i < 1000; ++i) {
+    source.push_back(ThrowingCopy(i));
+  }
+  Deque<ThrowingCopy, std::allocator<ThrowingCopy>, FixedChunkPolicy<4>> target;
+  target.push_back(ThrowingCopy(-1));
+  int alive = ThrowingCopy::alive;
+  for (int budget: {0, 1, 500, 999}) {
+    ThrowingCopy::copies_left = budget;
+    bool thrown = false;
+    try {
+      deque_parallel_append_copy(pool, target, source, small_tasks);
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    assert(thrown);
+    assert(target.size() == 1 && target[0].x == -1);
+    assert(ThrowingCopy::alive == alive);
+  }
+  ThrowingCopy::copies_left = 1'000'000;
+  deque_parallel_append_copy(pool, target, source, small_tasks);
+  assert(target.size() == 1001 && target[1000].x == 999);
+
+  Deque<int> mismatched(3);
+  Deque<int> other(4);
+  bool thrown = false;
+  try {
+    deque_parallel_transform(pool, mismatched, other, [](int x) { return x; });
+  } catch (const std::length_error&) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test3() {
+  for (size_t threads: {1, 4}) {
+    ThreadPool pool(threads);
+    ParallelOptions options{64, 0};
+    for (size_t count: {0, 1, 1000, 100'000, 1'000'000}) {
+      for (int modulo: {2, 1'000'000'000}) {
+        std::mt19937 gen(count + modulo);
+        std::vector<int> values(count);
+        for (auto& value: values) {
+          value = int(gen() % modulo);
+        }
+        Deque<int, std::allocator<int>, FixedChunkPolicy<64>> d(values.begin(), values.end());
+        deque_parallel_sort(pool, d, std::less<>(), options);
+        std::sort(values.begin(), values.end());
+        assert(std::equal(d.begin(), d.end(), values.begin(), values.end()));
+      }
+    }
+
+    Deque<std::string> words;
+    for (int i = 0; i < 100'000; ++i) {
+      words.push_back(std::to_string((i * 7919LL) % 100'000));
+    }
+    deque_parallel_sort(pool, words, std::greater<>(), options);
+    assert(std::is_sorted(words.begin(), words.end(), std::greater<>()) && words.size() == 100'000);
+  }
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Test 2 passed.\n";
+
+  test3();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -52,7 +52,7 @@ void TEST3() {
     my_deque.insert(my_deque.begin() + index, val);
     stl_deque.insert(stl_deque.begin() + index, val);
   }
-  CHECK()
+  CHECK();
 }
 
 int main() {
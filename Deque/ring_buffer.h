@@ -0,0 +1,783 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// what a push does once the ring holds capacity() elements
+enum class RingFullPolicy {
+  overwrite, // drop the element at the other end: push_back evicts the front, push_front the back
+  reject,    // leave the ring as it is and return false
+  block,     // wait until another thread pops; push, pop, size and clear take an internal mutex
+};
+
+// fixed-capacity ring with the interface of Deque: the slots are allocated once, rounded up to a power of two,
+// and element i lives at buffer_[(head_ + i) & mask_]. the elements form at most two contiguous segments
+template<typename T, typename Allocator = std::allocator<T>, RingFullPolicy Policy = RingFullPolicy::overwrite>
+class RingBuffer {
+ private:
+  using element_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  using AllocTraits = std::allocator_traits<element_allocator_type>;
+
+  static constexpr bool BLOCKING_ = Policy == RingFullPolicy::block;
+
+  struct NoSync {};
+  // a copied ring gets a mutex of its own
+  struct Sync {
+    std::mutex mutex;
+    std::condition_variable not_full;
+
+    Sync() = default;
+    Sync(const Sync&) noexcept {}
+    Sync& operator=(const Sync&) noexcept { return *this; }
+  };
+
+  element_allocator_type allocator_;
+  T* buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t mask_ = 0; // slot count - 1
+  size_t head_ = 0; // slot of the first element, always below the slot count
+  size_t size_ = 0;
+  [[no_unique_address]] mutable std::conditional_t<BLOCKING_, Sync, NoSync> sync_;
+
+  std::unique_lock<std::mutex> guard() const;
+  bool make_room(std::unique_lock<std::mutex>&);
+  template<typename... Args>
+  void overwrite(bool at_back, Args&&...);
+  void destroy_all() noexcept;
+  void deallocate() noexcept;
+  void take(RingBuffer<T, Allocator, Policy>&) noexcept;
+
+  template<bool is_const>
+  class CommonIterator;
+
+ public:
+  explicit RingBuffer(size_t capacity, const Allocator& = Allocator());
+  RingBuffer(const RingBuffer<T, Allocator, Policy>&);
+  RingBuffer(const RingBuffer<T, Allocator, Policy>&, const Allocator&);
+  RingBuffer(RingBuffer<T, Allocator, Policy>&&) noexcept;
+  ~RingBuffer() noexcept;
+
+  RingBuffer<T, Allocator, Policy>& operator=(const RingBuffer<T, Allocator, Policy>&);
+  RingBuffer<T, Allocator, Policy>& operator=(RingBuffer<T, Allocator, Policy>&&)
+      noexcept(AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value);
+
+  void swap(RingBuffer<T, Allocator, Policy>&) noexcept;
+
+  using allocator_type = Allocator;
+  using iterator = CommonIterator<false>;
+  using const_iterator = CommonIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using segment = std::span<T>;
+  using const_segment = std::span<const T>;
+
+  allocator_type get_allocator() const noexcept;
+
+  size_t size() const;
+  size_t capacity() const noexcept;
+  bool empty() const;
+  bool full() const;
+  T& operator[](ssize_t);
+  const T& operator[](ssize_t) const;
+  T& at(ssize_t);
+  const T& at(ssize_t) const;
+  T& front();
+  const T& front() const;
+  T& back();
+  const T& back() const;
+
+  // false only when RingFullPolicy::reject turned the element away
+  bool push_front(const T&);
+  bool push_front(T&&);
+  bool push_back(const T&);
+  bool push_back(T&&);
+  template<typename... Args>
+  bool emplace_front(Args&&...);
+  template<typename... Args>
+  bool emplace_back(Args&&...);
+
+  void pop_front();
+  void pop_back();
+  // moves the front element into value; with RingFullPolicy::block this is the consumer's side
+  bool try_pop_front(T&);
+  void clear();
+
+  iterator begin() noexcept;
+  const_iterator begin() const noexcept;
+  iterator end() noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cbegin() const noexcept;
+  const_iterator cend() const noexcept;
+
+  reverse_iterator rbegin() noexcept;
+  const_reverse_iterator rbegin() const noexcept;
+  const_reverse_iterator crbegin() const noexcept;
+  reverse_iterator rend() noexcept;
+  const_reverse_iterator rend() const noexcept;
+  const_reverse_iterator crend() const noexcept;
+
+  // the elements in order as two contiguous pieces, the second one empty unless the ring wraps
+  std::array<segment, 2> segments() noexcept;
+  std::array<const_segment, 2> segments() const noexcept;
+};
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+RingBuffer<T, Allocator, Policy>::RingBuffer(size_t capacity, const Allocator& allocator)
+    : allocator_(allocator), capacity_(capacity) {
+  if (capacity == 0) {
+    throw std::invalid_argument("ring buffer capacity must be positive");
+  }
+  size_t slots = std::bit_ceil(capacity);
+  buffer_ = AllocTraits::allocate(allocator_, slots);
+  mask_ = slots - 1;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+RingBuffer<T, Allocator, Policy>::RingBuffer(const RingBuffer<T, Allocator, Policy>& other)
+    : RingBuffer<T, Allocator, Policy>(
+          other, Allocator(AllocTraits::select_on_container_copy_construction(other.allocator_))) {}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+RingBuffer<T, Allocator, Policy>::RingBuffer(const RingBuffer<T, Allocator, Policy>& other, const Allocator& allocator)
+    : RingBuffer<T, Allocator, Policy>(other.capacity_, allocator) {
+  // the copy starts at slot 0; a throwing copy unwinds through the destructor
+  for (const_segment piece: other.segments()) {
+    for (const T& element: piece) {
+      AllocTraits::construct(allocator_, buffer_ + size_, element);
+      ++size_;
+    }
+  }
+}
+
+// the moved-from ring holds no slots and rejects pushes until it is assigned to
+template<typename T, typename Allocator, RingFullPolicy Policy>
+RingBuffer<T, Allocator, Policy>::RingBuffer(RingBuffer<T, Allocator, Policy>&& other) noexcept
+    : allocator_(other.allocator_), buffer_(other.buffer_), capacity_(other.capacity_), mask_(other.mask_),
+      head_(other.head_), size_(other.size_) {
+  other.buffer_ = nullptr;
+  other.capacity_ = 0;
+  other.mask_ = 0;
+  other.head_ = 0;
+  other.size_ = 0;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+RingBuffer<T, Allocator, Policy>::~RingBuffer() noexcept {
+  destroy_all();
+  deallocate();
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+RingBuffer<T, Allocator, Policy>& RingBuffer<T, Allocator, Policy>::operator=(
+    const RingBuffer<T, Allocator, Policy>& other) {
+  if (this != &other) {
+    RingBuffer<T, Allocator, Policy> copy(other, AllocTraits::propagate_on_container_copy_assignment::value ?
+                                                 Allocator(other.allocator_) : Allocator(allocator_));
+    take(copy);
+  }
+  return *this;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+RingBuffer<T, Allocator, Policy>& RingBuffer<T, Allocator, Policy>::operator=(RingBuffer<T, Allocator, Policy>&& other)
+    noexcept(AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value) {
+  if (this == &other) {
+    return *this;
+  }
+  if (AllocTraits::propagate_on_container_move_assignment::value || allocator_ == other.allocator_) {
+    take(other);
+  } else if (other.capacity_ == 0) {
+    destroy_all();
+    deallocate();
+    capacity_ = 0;
+    mask_ = 0;
+  } else {
+    // storage of a foreign allocator cannot be stolen, move the elements one by one
+    RingBuffer<T, Allocator, Policy> moved(other.capacity_, Allocator(allocator_));
+    for (segment piece: other.segments()) {
+      for (T& element: piece) {
+        AllocTraits::construct(moved.allocator_, moved.buffer_ + moved.size_, std::move(element));
+        ++moved.size_;
+      }
+    }
+    take(moved);
+  }
+  return *this;
+}
+
+// the mutexes stay with their objects, only the contents change hands
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void RingBuffer<T, Allocator, Policy>::swap(RingBuffer<T, Allocator, Policy>& other) noexcept {
+  if constexpr (AllocTraits::propagate_on_container_swap::value) {
+    std::swap(allocator_, other.allocator_);
+  }
+  std::swap(buffer_, other.buffer_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(mask_, other.mask_);
+  std::swap(head_, other.head_);
+  std::swap(size_, other.size_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void swap(RingBuffer<T, Allocator, Policy>& left, RingBuffer<T, Allocator, Policy>& right) noexcept {
+  left.swap(right);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+std::unique_lock<std::mutex> RingBuffer<T, Allocator, Policy>::guard() const {
+  if constexpr (BLOCKING_) {
+    return std::unique_lock<std::mutex>(sync_.mutex);
+  } else {
+    return std::unique_lock<std::mutex>();
+  }
+}
+
+// waits for or refuses a slot when the ring is full; false if the element cannot go in. a full overwrite
+// ring never gets here, it goes through overwrite()
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::make_room(std::unique_lock<std::mutex>& lock) {
+  if (size_ < capacity_) {
+    return true;
+  }
+  if constexpr (Policy == RingFullPolicy::block) {
+    if (capacity_ != 0) {
+      sync_.not_full.wait(lock, [this] { return size_ < capacity_; });
+      return true;
+    }
+  }
+  return false;
+}
+
+// puts an element into a full ring in place of the one at the other end. the new element is built before
+// the old one is destroyed, since args may refer to it: straight into the spare slot when the capacity is
+// below the slot count, else into a temporary that is move-assigned over the old one. a throwing
+// constructor leaves the ring as it was; a throwing move assignment leaves the old element in whatever
+// state T's assignment promises. only a T that cannot be move-assigned goes through destroy and construct,
+// and loses the old element if its move constructor throws
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<typename... Args>
+void RingBuffer<T, Allocator, Policy>::overwrite(bool at_back, Args&&... args) {
+  size_t victim = at_back ? head_ : ((head_ + size_ - 1) & mask_);
+  size_t slot = at_back ? ((head_ + size_) & mask_) : ((head_ - 1) & mask_);
+  if (slot != victim) {
+    AllocTraits::construct(allocator_, buffer_ + slot, std::forward<Args>(args)...);
+    AllocTraits::destroy(allocator_, buffer_ + victim);
+  } else if constexpr (std::is_move_assignable_v<T>) {
+    T element(std::forward<Args>(args)...);
+    buffer_[victim] = std::move(element);
+  } else {
+    T element(std::forward<Args>(args)...);
+    AllocTraits::destroy(allocator_, buffer_ + victim);
+    try {
+      AllocTraits::construct(allocator_, buffer_ + slot, std::move(element));
+    } catch (...) {
+      // the victim is gone either way, the ring is one element shorter
+      head_ = at_back ? ((head_ + 1) & mask_) : head_;
+      --size_;
+      throw;
+    }
+  }
+  head_ = at_back ? ((head_ + 1) & mask_) : slot;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void RingBuffer<T, Allocator, Policy>::destroy_all() noexcept {
+  if constexpr (!std::is_trivially_destructible_v<T> ||
+                !std::is_same_v<element_allocator_type, std::allocator<T>>) {
+    for (size_t i = 0; i < size_; ++i) {
+      AllocTraits::destroy(allocator_, buffer_ + ((head_ + i) & mask_));
+    }
+  }
+  head_ = 0;
+  size_ = 0;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void RingBuffer<T, Allocator, Policy>::deallocate() noexcept {
+  if (buffer_ != nullptr) {
+    AllocTraits::deallocate(allocator_, buffer_, mask_ + 1);
+    buffer_ = nullptr;
+  }
+}
+
+// frees this ring's storage and steals other's together with its allocator; other is left holding no slots
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void RingBuffer<T, Allocator, Policy>::take(RingBuffer<T, Allocator, Policy>& other) noexcept {
+  destroy_all();
+  deallocate();
+  allocator_ = other.allocator_;
+  buffer_ = other.buffer_;
+  capacity_ = other.capacity_;
+  mask_ = other.mask_;
+  head_ = other.head_;
+  size_ = other.size_;
+  other.buffer_ = nullptr;
+  other.capacity_ = 0;
+  other.mask_ = 0;
+  other.head_ = 0;
+  other.size_ = 0;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::allocator_type
+RingBuffer<T, Allocator, Policy>::get_allocator() const noexcept {
+  return allocator_type(allocator_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+size_t RingBuffer<T, Allocator, Policy>::size() const {
+  auto lock = guard();
+  return size_;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+size_t RingBuffer<T, Allocator, Policy>::capacity() const noexcept {
+  return capacity_;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::empty() const {
+  return size() == 0;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::full() const {
+  return size() == capacity_;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+T& RingBuffer<T, Allocator, Policy>::operator[](ssize_t index) {
+  return buffer_[(head_ + index) & mask_];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+const T& RingBuffer<T, Allocator, Policy>::operator[](ssize_t index) const {
+  return buffer_[(head_ + index) & mask_];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+T& RingBuffer<T, Allocator, Policy>::at(ssize_t index) {
+  if (index < 0 || index >= ssize_t(size_)) {
+    throw std::out_of_range("out of range");
+  } else {
+    return this->operator[](index);
+  }
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+const T& RingBuffer<T, Allocator, Policy>::at(ssize_t index) const {
+  if (index < 0 || index >= ssize_t(size_)) {
+    throw std::out_of_range("out of range");
+  } else {
+    return this->operator[](index);
+  }
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+T& RingBuffer<T, Allocator, Policy>::front() {
+  return (*this)[0];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+const T& RingBuffer<T, Allocator, Policy>::front() const {
+  return (*this)[0];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+T& RingBuffer<T, Allocator, Policy>::back() {
+  return (*this)[size_ - 1];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+const T& RingBuffer<T, Allocator, Policy>::back() const {
+  return (*this)[size_ - 1];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::push_front(const T& value) {
+  return emplace_front(value);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::push_front(T&& value) {
+  return emplace_front(std::move(value));
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::push_back(const T& value) {
+  return emplace_back(value);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::push_back(T&& value) {
+  return emplace_back(std::move(value));
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<typename... Args>
+bool RingBuffer<T, Allocator, Policy>::emplace_front(Args&&... args) {
+  auto lock = guard();
+  if constexpr (Policy == RingFullPolicy::overwrite) {
+    if (size_ == capacity_ && capacity_ != 0) {
+      overwrite(false, std::forward<Args>(args)...);
+      return true;
+    }
+  }
+  if (!make_room(lock)) {
+    return false;
+  }
+  size_t slot = (head_ - 1) & mask_;
+  AllocTraits::construct(allocator_, buffer_ + slot, std::forward<Args>(args)...);
+  head_ = slot;
+  ++size_;
+  return true;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<typename... Args>
+bool RingBuffer<T, Allocator, Policy>::emplace_back(Args&&... args) {
+  auto lock = guard();
+  if constexpr (Policy == RingFullPolicy::overwrite) {
+    if (size_ == capacity_ && capacity_ != 0) {
+      overwrite(true, std::forward<Args>(args)...);
+      return true;
+    }
+  }
+  if (!make_room(lock)) {
+    return false;
+  }
+  AllocTraits::construct(allocator_, buffer_ + ((head_ + size_) & mask_), std::forward<Args>(args)...);
+  ++size_;
+  return true;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void RingBuffer<T, Allocator, Policy>::pop_front() {
+  auto lock = guard();
+  if (size_ == 0) {
+    throw std::out_of_range("ring buffer is empty");
+  }
+  AllocTraits::destroy(allocator_, buffer_ + head_);
+  head_ = (head_ + 1) & mask_;
+  --size_;
+  if constexpr (BLOCKING_) {
+    sync_.not_full.notify_one();
+  }
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void RingBuffer<T, Allocator, Policy>::pop_back() {
+  auto lock = guard();
+  if (size_ == 0) {
+    throw std::out_of_range("ring buffer is empty");
+  }
+  AllocTraits::destroy(allocator_, buffer_ + ((head_ + size_ - 1) & mask_));
+  --size_;
+  if constexpr (BLOCKING_) {
+    sync_.not_full.notify_one();
+  }
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+bool RingBuffer<T, Allocator, Policy>::try_pop_front(T& value) {
+  auto lock = guard();
+  if (size_ == 0) {
+    return false;
+  }
+  value = std::move(buffer_[head_]);
+  AllocTraits::destroy(allocator_, buffer_ + head_);
+  head_ = (head_ + 1) & mask_;
+  --size_;
+  if constexpr (BLOCKING_) {
+    sync_.not_full.notify_one();
+  }
+  return true;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+void RingBuffer<T, Allocator, Policy>::clear() {
+  auto lock = guard();
+  destroy_all();
+  if constexpr (BLOCKING_) {
+    sync_.not_full.notify_all();
+  }
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+std::array<typename RingBuffer<T, Allocator, Policy>::segment, 2> RingBuffer<T, Allocator, Policy>::segments() noexcept {
+  size_t first = std::min(size_, mask_ + 1 - head_);
+  return {segment(buffer_ + head_, first), segment(buffer_, size_ - first)};
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+std::array<typename RingBuffer<T, Allocator, Policy>::const_segment, 2>
+RingBuffer<T, Allocator, Policy>::segments() const noexcept {
+  size_t first = std::min(size_, mask_ + 1 - head_);
+  return {const_segment(buffer_ + head_, first), const_segment(buffer_, size_ - first)};
+}
+
+// a position counted from the start of the buffer without masking, so end() is one past the last element
+// even when the ring is full
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+class RingBuffer<T, Allocator, Policy>::CommonIterator {
+ private:
+  T* buffer_ = nullptr;
+  size_t mask_ = 0;
+  size_t position_ = 0;
+
+ public:
+  CommonIterator() = default;
+
+  CommonIterator(T* buffer, size_t mask, size_t position) noexcept;
+
+  using value_type = T;
+  using iterator_category = std::random_access_iterator_tag;
+  using difference_type = ssize_t;
+  using reference = typename std::conditional<is_const, const T&, T&>::type;
+  using pointer = typename std::conditional<is_const, const T*, T*>::type;
+
+  operator CommonIterator<true>() const noexcept;
+
+  const CommonIterator<is_const> operator--(int) noexcept;
+  const CommonIterator<is_const> operator++(int) noexcept;
+  CommonIterator<is_const>& operator--() noexcept;
+  CommonIterator<is_const>& operator++() noexcept;
+  CommonIterator<is_const>& operator+=(difference_type) noexcept;
+  CommonIterator<is_const>& operator-=(difference_type) noexcept;
+  CommonIterator<is_const> operator+(difference_type) const noexcept;
+  CommonIterator<is_const> operator-(difference_type) const noexcept;
+
+  reference operator*() const;
+  pointer operator->() const;
+  reference operator[](difference_type) const;
+
+  difference_type operator-(const CommonIterator<is_const>&) const noexcept;
+  bool operator<(const CommonIterator<is_const>&) const noexcept;
+  bool operator==(const CommonIterator<is_const>&) const noexcept;
+  bool operator>(const CommonIterator<is_const>&) const noexcept;
+  bool operator<=(const CommonIterator<is_const>&) const noexcept;
+  bool operator>=(const CommonIterator<is_const>&) const noexcept;
+  bool operator!=(const CommonIterator<is_const>&) const noexcept;
+};
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::CommonIterator(T* buffer, size_t mask,
+                                                                        size_t position) noexcept
+    : buffer_(buffer), mask_(mask), position_(position) {}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
+  return CommonIterator<true>(buffer_, mask_, position_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+const typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator--(int) noexcept {
+  CommonIterator temp_iterator(*this);
+  --position_;
+  return temp_iterator;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+const typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator++(int) noexcept {
+  CommonIterator temp_iterator(*this);
+  ++position_;
+  return temp_iterator;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>&
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator--() noexcept {
+  --position_;
+  return *this;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>&
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator++() noexcept {
+  ++position_;
+  return *this;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>&
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator+=(difference_type delta) noexcept {
+  position_ += delta;
+  return *this;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>&
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator-=(difference_type delta) noexcept {
+  position_ -= delta;
+  return *this;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator+(difference_type delta) const noexcept {
+  CommonIterator<is_const> result(*this);
+  return result += delta;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator-(difference_type delta) const noexcept {
+  CommonIterator<is_const> result(*this);
+  return result -= delta;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>::reference
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator*() const {
+  return buffer_[position_ & mask_];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>::pointer
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator->() const {
+  return buffer_ + (position_ & mask_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>::reference
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator[](difference_type delta) const {
+  return buffer_[(position_ + delta) & mask_];
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+typename RingBuffer<T, Allocator, Policy>::template CommonIterator<is_const>::difference_type
+RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator-(
+    const CommonIterator<is_const>& other) const noexcept {
+  return difference_type(position_ - other.position_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+bool RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator<(
+    const CommonIterator<is_const>& other) const noexcept {
+  return position_ < other.position_;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+bool RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator==(
+    const CommonIterator<is_const>& other) const noexcept {
+  return position_ == other.position_;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+bool RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator>(
+    const CommonIterator<is_const>& other) const noexcept {
+  return other < *this;
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+bool RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator<=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(other < *this);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+bool RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator>=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this < other);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+template<bool is_const>
+bool RingBuffer<T, Allocator, Policy>::CommonIterator<is_const>::operator!=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this == other);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::iterator RingBuffer<T, Allocator, Policy>::begin() noexcept {
+  return iterator(buffer_, mask_, head_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_iterator RingBuffer<T, Allocator, Policy>::begin() const noexcept {
+  return const_iterator(buffer_, mask_, head_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::iterator RingBuffer<T, Allocator, Policy>::end() noexcept {
+  return iterator(buffer_, mask_, head_ + size_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_iterator RingBuffer<T, Allocator, Policy>::end() const noexcept {
+  return const_iterator(buffer_, mask_, head_ + size_);
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_iterator RingBuffer<T, Allocator, Policy>::cbegin() const noexcept {
+  return begin();
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_iterator RingBuffer<T, Allocator, Policy>::cend() const noexcept {
+  return end();
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::reverse_iterator RingBuffer<T, Allocator, Policy>::rbegin() noexcept {
+  return reverse_iterator(end());
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_reverse_iterator
+RingBuffer<T, Allocator, Policy>::rbegin() const noexcept {
+  return const_reverse_iterator(end());
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_reverse_iterator
+RingBuffer<T, Allocator, Policy>::crbegin() const noexcept {
+  return const_reverse_iterator(end());
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::reverse_iterator RingBuffer<T, Allocator, Policy>::rend() noexcept {
+  return reverse_iterator(begin());
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_reverse_iterator
+RingBuffer<T, Allocator, Policy>::rend() const noexcept {
+  return const_reverse_iterator(begin());
+}
+
+template<typename T, typename Allocator, RingFullPolicy Policy>
+typename RingBuffer<T, Allocator, Policy>::const_reverse_iterator
+RingBuffer<T, Allocator, Policy>::crend() const noexcept {
+  return const_reverse_iterator(begin());
+}
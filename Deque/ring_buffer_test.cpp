@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ring_buffer.h"
+
+struct Counted {
+  static int alive;
+
+  int x = 0;
+
+  Counted(int x) : x(x) { ++alive; }
+  Counted(const Counted& other) : x(other.x) { ++alive; }
+  Counted& operator=(const Counted& other) = default;
+  ~Counted() { --alive; }
+};
+
+int Counted::alive = 0;
+
+// stateful allocator that never propagates; every buffer must go back to the arena it came from
+// moves by construction throw once armed, moves by assignment never do
+struct MoveThrows {
+  static bool armed;
+
+  int x = 0;
+
+  MoveThrows(int x) : x(x) {}
+  MoveThrows(MoveThrows&& other) : x(other.x) {
+    if (armed) {
+      throw std::runtime_error("move");
+    }
+  }
+  MoveThrows& operator=(MoveThrows&& other) noexcept {
+    x = other.x;
+    return *this;
+  }
+};
+
+bool MoveThrows::armed = false;
+
+template<typename T>
+struct ArenaAllocator {
+  static std::map<void*, int> owners;
+
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+
+  int arena = 0;
+
+  ArenaAllocator(int arena) : arena(arena) {}
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(size_t count) {
+    T* pointer = std::allocator<T>().allocate(count);
+    owners[pointer] = arena;
+    return pointer;
+  }
+
+  void deallocate(T* pointer, size_t count) {
+    assert(owners.at(pointer) == arena);
+    owners.erase(pointer);
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  template<typename U>
+  bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+};
+
+template<typename T>
+std::map<void*, int> ArenaAllocator<T>::owners;
+
+template<typename Ring>
+std::vector<int> Contents(const Ring& ring) {
+  std::vector<int> result;
+  for (auto piece: ring.segments()) {
+    result.insert(result.end(), piece.begin(), piece.end());
+  }
+  assert(std::equal(result.begin(), result.end(), ring.begin(), ring.end()));
+  return result;
+}
+
+void test1() {
+  // capacity 5 sits in 8 slots, so the window wraps at a different place every lap
+  RingBuffer<int> ring(5);
+  assert(ring.capacity() == 5 && ring.empty());
+  for (int i = 0; i < 100; ++i) {
+    assert(ring.push_back(i));
+    size_t expected = std::min(i + 1, 5);
+    assert(ring.size() == expected && ring.back() == i && ring.front() == i + 1 - int(expected));
+    std::vector<int> window(expected);
+    std::iota(window.begin(), window.end(), i + 1 - int(expected));
+    assert(Contents(ring) == window);
+    auto pieces = ring.segments();
+    assert(pieces[0].size() + pieces[1].size() == expected && !pieces[0].empty());
+  }
+  assert(ring.full());
+
+  // push_front evicts the back
+  ring.push_front(-1);
+  assert((Contents(ring) == std::vector<int>{-1, 95, 96, 97, 98}));
+  ring.pop_back();
+  ring.pop_front();
+  assert((Contents(ring) == std::vector<int>{95, 96, 97}));
+  assert(ring[1] == 96 && ring.at(2) == 97);
+  bool thrown = false;
+  try {
+    ring.at(3);
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  std::reverse(ring.begin(), ring.end());
+  assert((Contents(ring) == std::vector<int>{97, 96, 95}));
+  assert(*ring.rbegin() == 95 && ring.end() - ring.begin() == 3);
+
+  int value = 0;
+  assert(ring.try_pop_front(value) && value == 97);
+  ring.clear();
+  assert(ring.empty() && !ring.try_pop_front(value));
+  thrown = false;
+  try {
+    ring.pop_front();
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  thrown = false;
+  try {
+    RingBuffer<int> empty(0);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test2() {
+  RingBuffer<int, std::allocator<int>, RingFullPolicy::reject> ring(4);
+  for (int i = 0; i < 4; ++i) {
+    assert(ring.push_back(i));
+  }
+  assert(!ring.push_back(4) && !ring.push_front(-1) && !ring.emplace_back(5));
+  assert((Contents(ring) == std::vector<int>{0, 1, 2, 3}));
+  ring.pop_front();
+  assert(ring.push_front(-1));
+  assert((Contents(ring) == std::vector<int>{-1, 1, 2, 3}));
+
+  {
+    RingBuffer<Counted, std::allocator<Counted>, RingFullPolicy::overwrite> counted(3);
+    for (int i = 0; i < 10; ++i) {
+      counted.emplace_back(i);
+    }
+    assert(Counted::alive == 3 && counted.front().x == 7);
+
+    RingBuffer<Counted, std::allocator<Counted>, RingFullPolicy::overwrite> copy(counted);
+    assert(Counted::alive == 6 && copy.front().x == 7 && copy.back().x == 9);
+    copy.push_back(10);
+    counted = copy;
+    assert(Counted::alive == 6 && counted.front().x == 8);
+
+    RingBuffer<Counted, std::allocator<Counted>, RingFullPolicy::overwrite> moved(std::move(counted));
+    assert(Counted::alive == 6 && moved.back().x == 10);
+    assert(counted.size() == 0 && !counted.push_back(1));
+    counted = std::move(moved);
+    assert(counted.size() == 3 && Counted::alive == 6);
+  }
+  assert(Counted::alive == 0);
+
+  RingBuffer<std::string> words(2);
+  words.push_back(std::string(100, 'a'));
+  words.push_back("b");
+  words.push_back("c");
+  std::string word;
+  assert(words.try_pop_front(word) && word == "b");
+
+  // pushing the element a full ring is about to evict, with and without a spare slot
+  for (size_t capacity: {3, 4}) {
+    RingBuffer<std::string> names(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+      names.push_back(std::string(40, char('a' + i)));
+    }
+    names.push_back(names.front());
+    assert(names.back() == std::string(40, 'a') && names.front() == std::string(40, 'b'));
+    names.push_front(names.back());
+    assert(names.front() == std::string(40, 'a') && names.back()[0] == char('a' + capacity - 1));
+    assert(names.size() == capacity);
+  }
+
+  // a constructor that throws leaves a full ring as it was
+  RingBuffer<std::string> full(4);
+  for (int i = 0; i < 4; ++i) {
+    full.push_back(std::to_string(i));
+  }
+  bool thrown = false;
+  try {
+    full.emplace_back(size_t(-1), 'x');
+  } catch (const std::exception&) {
+    thrown = true;
+  }
+  assert(thrown && full.size() == 4 && full.front() == "0" && full.back() == "3");
+
+  // the temporary is assigned over the evicted element, so a throwing move constructor cannot lose it
+  {
+    RingBuffer<MoveThrows> ring(4);
+    for (int i = 0; i < 4; ++i) {
+      ring.emplace_back(i);
+    }
+    MoveThrows::armed = true;
+    ring.emplace_back(4);
+    ring.emplace_front(-1);
+    MoveThrows::armed = false;
+    assert(ring.size() == 4 && ring.front().x == -1 && ring[1].x == 1 && ring.back().x == 3);
+  }
+
+  // allocators that do not propagate stay with their rings, the elements move between arenas
+  {
+    using Arena = ArenaAllocator<int>;
+    RingBuffer<int, Arena> first(3, Arena(1));
+    RingBuffer<int, Arena> second(5, Arena(2));
+    first.push_back(1);
+    first.push_back(2);
+    second.push_back(3);
+    second = std::move(first);
+    assert(second.get_allocator().arena == 2 && (Contents(second) == std::vector<int>{1, 2}));
+    first = second;
+    assert(first.get_allocator().arena == 1 && (Contents(first) == std::vector<int>{1, 2}));
+    RingBuffer<int, Arena> same(4, Arena(1));
+    same.push_back(7);
+    swap(first, same);
+    assert(first.get_allocator().arena == 1 && (Contents(first) == std::vector<int>{7}));
+    RingBuffer<int, Arena> stolen(std::move(same));
+    second = std::move(same);
+    assert(second.capacity() == 0 && second.get_allocator().arena == 2 && !second.push_back(1));
+  }
+  assert(ArenaAllocator<int>::owners.empty());
+}
+
+void test3() {
+  // a producer that outruns the consumer waits instead of losing anything
+  RingBuffer<size_t, std::allocator<size_t>, RingFullPolicy::block> ring(8);
+  const size_t count = 100'000;
+  std::thread producer([&] {
+    for (size_t i = 0; i < count; ++i) {
+      ring.push_back(i);
+    }
+  });
+  size_t expected = 0;
+  size_t value = 0;
+  while (expected < count) {
+    if (ring.try_pop_front(value)) {
+      assert(value == expected++);
+    } else {
+      std::this_thread::yield();
+    }
+    assert(ring.size() <= 8);
+  }
+  producer.join();
+  assert(ring.empty());
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Test 2 passed.\n";
+
+  test3();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -0,0 +1,1050 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "deque.h"
+
+// Deque with the first InlineN elements kept in the object itself: a ring over inline slots, no chunks, so a
+// deque that stays small never allocates. the first push past InlineN moves the elements into a regular Deque,
+// which serves every operation from then on, also after the deque shrinks again.
+// the slot count is rounded up to a power of two and the ring is reached through a two-entry map whose
+// entries both point at the slots, so a wrapped ring looks like two chunks and the iterators walk either
+// layout the way Deque's do, without asking which one they are in
+template<typename T, size_t InlineN, typename Allocator = std::allocator<T>, typename ChunkPolicy = SmallChunkPolicy>
+class SmallDeque {
+ private:
+  static_assert(InlineN > 0, "a small deque needs at least one inline slot");
+
+  using heap_type = Deque<T, Allocator, ChunkPolicy>;
+  using element_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  using AllocTraits = std::allocator_traits<element_allocator_type>;
+
+  static constexpr size_t SLOTS_ = std::bit_ceil(InlineN);
+  static constexpr size_t SHIFT_ = chunk_shift(SLOTS_);
+  static constexpr size_t MASK_ = SLOTS_ - 1;
+  static constexpr size_t HEAP_SHIFT_ = chunk_shift(ChunkPolicy::template chunk_size<T>());
+
+  element_allocator_type allocator_;
+  alignas(T) unsigned char storage_[SLOTS_ * sizeof(T)];
+  T* map_[2]; // both entries are the inline slots
+  size_t head_ = 0; // inline slot of the first element
+  size_t size_ = 0; // inline elements, unused once heap_ is engaged
+  std::optional<heap_type> heap_;
+
+  T* slot(size_t) noexcept;
+  const T* slot(size_t) const noexcept;
+  void destroy_inline() noexcept;
+  void move_inline_from(SmallDeque<T, InlineN, Allocator, ChunkPolicy>&);
+  void swap_inline(SmallDeque<T, InlineN, Allocator, ChunkPolicy>&);
+  void take(SmallDeque<T, InlineN, Allocator, ChunkPolicy>&);
+  void spill();
+
+  // the node holding the first element, its index there and the chunk shift of the current layout
+  T* const* first_node() const noexcept;
+  size_t first_index() const noexcept;
+  size_t shift() const noexcept;
+
+  template<bool is_const>
+  class CommonIterator;
+  template<bool is_const>
+  class CommonSegmentIterator;
+  template<bool is_const>
+  class CommonSegmentView;
+
+ public:
+  SmallDeque() noexcept(std::is_nothrow_default_constructible_v<Allocator>);
+  explicit SmallDeque(const Allocator&) noexcept;
+  SmallDeque(const SmallDeque<T, InlineN, Allocator, ChunkPolicy>&);
+  SmallDeque(const SmallDeque<T, InlineN, Allocator, ChunkPolicy>&, const Allocator&);
+  SmallDeque(SmallDeque<T, InlineN, Allocator, ChunkPolicy>&&) noexcept(std::is_nothrow_move_constructible_v<T>);
+  ~SmallDeque() noexcept;
+
+  SmallDeque<T, InlineN, Allocator, ChunkPolicy>& operator=(const SmallDeque<T, InlineN, Allocator, ChunkPolicy>&);
+  SmallDeque<T, InlineN, Allocator, ChunkPolicy>& operator=(SmallDeque<T, InlineN, Allocator, ChunkPolicy>&&)
+      noexcept(std::is_nothrow_move_constructible_v<T> &&
+               (AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value));
+
+  // two heap deques trade their maps, inline elements are swapped and moved one by one
+  void swap(SmallDeque<T, InlineN, Allocator, ChunkPolicy>&)
+      noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_swappable_v<T>);
+
+  using allocator_type = Allocator;
+  using iterator = CommonIterator<false>;
+  using const_iterator = CommonIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using segment = std::span<T>;
+  using const_segment = std::span<const T>;
+  using segment_view = CommonSegmentView<false>;
+  using const_segment_view = CommonSegmentView<true>;
+
+  allocator_type get_allocator() const noexcept;
+
+  // true until the first push past InlineN
+  bool is_inline() const noexcept;
+  size_t size() const noexcept;
+  T& operator[](ssize_t);
+  const T& operator[](ssize_t) const;
+  T& at(ssize_t);
+  const T& at(ssize_t) const;
+  T& front();
+  const T& front() const;
+  T& back();
+  const T& back() const;
+
+  void push_front(const T&);
+  void push_front(T&&);
+  void push_back(const T&);
+  void push_back(T&&);
+  void pop_front();
+  void pop_back();
+  void clear() noexcept;
+
+  template<typename... Args>
+  T& emplace_front(Args&&...);
+  template<typename... Args>
+  T& emplace_back(Args&&...);
+  template<typename... Args>
+  iterator emplace(iterator, Args&&...);
+
+  void insert(iterator, const T&);
+  void insert(iterator, T&&);
+  iterator erase(iterator);
+  iterator erase(iterator, iterator);
+
+  // the elements as at most two inline spans, or as the chunks of the heap deque
+  segment_view segments() noexcept;
+  const_segment_view segments() const noexcept;
+  segment_view segments(size_t, size_t) noexcept;
+  const_segment_view segments(size_t, size_t) const noexcept;
+  template<typename Func>
+  void for_each_segment(Func&&);
+  template<typename Func>
+  void for_each_segment(Func&&) const;
+  template<typename Func>
+  void for_each_segment(size_t, size_t, Func&&);
+  template<typename Func>
+  void for_each_segment(size_t, size_t, Func&&) const;
+
+  iterator begin() noexcept;
+  const_iterator begin() const noexcept;
+  iterator end() noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cbegin() const noexcept;
+  const_iterator cend() const noexcept;
+
+  reverse_iterator rbegin() noexcept;
+  const_reverse_iterator rbegin() const noexcept;
+  const_reverse_iterator crbegin() const noexcept;
+  reverse_iterator rend() noexcept;
+  const_reverse_iterator rend() const noexcept;
+  const_reverse_iterator crend() const noexcept;
+};
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::SmallDeque() noexcept(std::is_nothrow_default_constructible_v<Allocator>)
+    : SmallDeque<T, InlineN, Allocator, ChunkPolicy>(Allocator()) {}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::SmallDeque(const Allocator& allocator) noexcept
+    : allocator_(allocator), map_{reinterpret_cast<T*>(storage_), reinterpret_cast<T*>(storage_)} {}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::SmallDeque(const SmallDeque<T, InlineN, Allocator, ChunkPolicy>& other)
+    : SmallDeque<T, InlineN, Allocator, ChunkPolicy>(
+          other, AllocTraits::select_on_container_copy_construction(other.allocator_)) {}
+
+// a copy of a heap deque that fits goes back inline
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::SmallDeque(const SmallDeque<T, InlineN, Allocator, ChunkPolicy>& other,
+                                                           const Allocator& allocator)
+    : SmallDeque<T, InlineN, Allocator, ChunkPolicy>(allocator) {
+  if (other.size() > InlineN) {
+    heap_.emplace(Allocator(allocator_));
+    heap_->append(other.begin(), other.end());
+    return;
+  }
+  for (const T& element: other) {
+    AllocTraits::construct(allocator_, slot(size_), element);
+    ++size_;
+  }
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::SmallDeque(SmallDeque<T, InlineN, Allocator, ChunkPolicy>&& other)
+    noexcept(std::is_nothrow_move_constructible_v<T>)
+    : SmallDeque<T, InlineN, Allocator, ChunkPolicy>(Allocator(other.allocator_)) {
+  if (other.heap_) {
+    heap_.emplace(std::move(*other.heap_));
+    other.heap_.reset();
+  } else {
+    move_inline_from(other);
+  }
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::~SmallDeque() noexcept {
+  destroy_inline();
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::operator=(
+    const SmallDeque<T, InlineN, Allocator, ChunkPolicy>& other) {
+  if (this != &other) {
+    SmallDeque<T, InlineN, Allocator, ChunkPolicy> copy(other, AllocTraits::propagate_on_container_copy_assignment::value ?
+                                                                   Allocator(other.allocator_) : Allocator(allocator_));
+    take(copy);
+  }
+  return *this;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::operator=(
+    SmallDeque<T, InlineN, Allocator, ChunkPolicy>&& other)
+    noexcept(std::is_nothrow_move_constructible_v<T> &&
+             (AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value)) {
+  if (this == &other) {
+    return *this;
+  }
+  if (AllocTraits::propagate_on_container_move_assignment::value || allocator_ == other.allocator_) {
+    take(other);
+  } else {
+    // a heap deque of a foreign allocator cannot be stolen, move the elements one by one
+    SmallDeque<T, InlineN, Allocator, ChunkPolicy> moved{Allocator(allocator_)};
+    for (T& element: other) {
+      moved.emplace_back(std::move(element));
+    }
+    take(moved);
+  }
+  return *this;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::swap(SmallDeque<T, InlineN, Allocator, ChunkPolicy>& other)
+    noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_swappable_v<T>) {
+  // swapped first, so inline elements are built by the allocator of the deque they end up in
+  if constexpr (AllocTraits::propagate_on_container_swap::value) {
+    std::swap(allocator_, other.allocator_);
+  }
+  if (heap_ && other.heap_) {
+    // Deque::swap follows propagate_on_container_swap for the heap allocators
+    heap_->swap(*other.heap_);
+  } else if (!heap_ && !other.heap_) {
+    swap_inline(other);
+  } else {
+    SmallDeque<T, InlineN, Allocator, ChunkPolicy>& spilled = heap_ ? *this : other;
+    SmallDeque<T, InlineN, Allocator, ChunkPolicy>& packed = heap_ ? other : *this;
+    spilled.move_inline_from(packed);
+    packed.heap_.emplace(std::move(*spilled.heap_));
+    spilled.heap_.reset();
+  }
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void swap(SmallDeque<T, InlineN, Allocator, ChunkPolicy>& left, SmallDeque<T, InlineN, Allocator, ChunkPolicy>& right)
+    noexcept(noexcept(left.swap(right))) {
+  left.swap(right);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+T* SmallDeque<T, InlineN, Allocator, ChunkPolicy>::slot(size_t index) noexcept {
+  return std::launder(reinterpret_cast<T*>(storage_) + ((head_ + index) & MASK_));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+const T* SmallDeque<T, InlineN, Allocator, ChunkPolicy>::slot(size_t index) const noexcept {
+  return std::launder(reinterpret_cast<const T*>(storage_) + ((head_ + index) & MASK_));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::destroy_inline() noexcept {
+  for (size_t i = 0; i < size_; ++i) {
+    AllocTraits::destroy(allocator_, slot(i));
+  }
+  head_ = 0;
+  size_ = 0;
+}
+
+// takes the inline elements of other, which is left empty; this deque must hold nothing
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::move_inline_from(SmallDeque<T, InlineN, Allocator, ChunkPolicy>& other) {
+  try {
+    for (; size_ < other.size_; ++size_) {
+      AllocTraits::construct(allocator_, slot(size_), std::move(*other.slot(size_)));
+    }
+  } catch (...) {
+    destroy_inline();
+    throw;
+  }
+  other.destroy_inline();
+}
+
+// swaps the common prefix in place, then moves the rest of the longer ring across
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::swap_inline(SmallDeque<T, InlineN, Allocator, ChunkPolicy>& other) {
+  using std::swap;
+  SmallDeque<T, InlineN, Allocator, ChunkPolicy>& longer = size_ < other.size_ ? other : *this;
+  SmallDeque<T, InlineN, Allocator, ChunkPolicy>& shorter = size_ < other.size_ ? *this : other;
+  size_t common = shorter.size_;
+  for (size_t i = 0; i < common; ++i) {
+    swap(*slot(i), *other.slot(i));
+  }
+  for (; shorter.size_ < longer.size_; ++shorter.size_) {
+    AllocTraits::construct(shorter.allocator_, shorter.slot(shorter.size_), std::move(*longer.slot(shorter.size_)));
+  }
+  for (size_t i = common; i < longer.size_; ++i) {
+    AllocTraits::destroy(longer.allocator_, longer.slot(i));
+  }
+  longer.size_ = common;
+}
+
+// steals the elements and the allocator of other, which is left empty
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::take(SmallDeque<T, InlineN, Allocator, ChunkPolicy>& other) {
+  destroy_inline();
+  heap_.reset();
+  allocator_ = other.allocator_;
+  if (other.heap_) {
+    heap_.emplace(std::move(*other.heap_));
+    other.heap_.reset();
+  } else {
+    move_inline_from(other);
+  }
+}
+
+// moves the inline elements into a fresh Deque with room for what they will grow to; if a move throws,
+// the inline elements are left as they were
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::spill() {
+  heap_type heap{Allocator(allocator_)};
+  heap.reserve_back(2 * InlineN);
+  for (size_t i = 0; i < size_; ++i) {
+    heap.emplace_back(std::move_if_noexcept(*slot(i)));
+  }
+  destroy_inline();
+  heap_.emplace(std::move(heap));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+T* const* SmallDeque<T, InlineN, Allocator, ChunkPolicy>::first_node() const noexcept {
+  return heap_ ? heap_->begin().get_ptr() : map_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+size_t SmallDeque<T, InlineN, Allocator, ChunkPolicy>::first_index() const noexcept {
+  return heap_ ? heap_->begin().get_index() : head_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+size_t SmallDeque<T, InlineN, Allocator, ChunkPolicy>::shift() const noexcept {
+  return heap_ ? HEAP_SHIFT_ : SHIFT_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::allocator_type
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::get_allocator() const noexcept {
+  return Allocator(allocator_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::is_inline() const noexcept {
+  return !heap_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+size_t SmallDeque<T, InlineN, Allocator, ChunkPolicy>::size() const noexcept {
+  return heap_ ? heap_->size() : size_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::operator[](ssize_t index) {
+  return heap_ ? (*heap_)[index] : *slot(index);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+const T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::operator[](ssize_t index) const {
+  return heap_ ? (*heap_)[index] : *slot(index);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::at(ssize_t index) {
+  if (index < 0 || index >= ssize_t(size())) {
+    throw std::out_of_range("out of range");
+  } else {
+    return this->operator[](index);
+  }
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+const T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::at(ssize_t index) const {
+  if (index < 0 || index >= ssize_t(size())) {
+    throw std::out_of_range("out of range");
+  } else {
+    return this->operator[](index);
+  }
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::front() {
+  return (*this)[0];
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+const T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::front() const {
+  return (*this)[0];
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::back() {
+  return (*this)[size() - 1];
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+const T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::back() const {
+  return (*this)[size() - 1];
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::push_front(const T& element) {
+  emplace_front(element);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::push_front(T&& element) {
+  emplace_front(std::move(element));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::push_back(const T& element) {
+  emplace_back(element);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::push_back(T&& element) {
+  emplace_back(std::move(element));
+}
+
+// the element is built before a spill, since args may refer to an inline element
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::emplace_front(Args&&... args) {
+  if (heap_) {
+    return heap_->emplace_front(std::forward<Args>(args)...);
+  }
+  if (size_ == InlineN) {
+    T element(std::forward<Args>(args)...);
+    spill();
+    return heap_->emplace_front(std::move(element));
+  }
+  size_t first = (head_ - 1) & MASK_;
+  T* target = std::launder(reinterpret_cast<T*>(storage_) + first);
+  AllocTraits::construct(allocator_, target, std::forward<Args>(args)...);
+  head_ = first;
+  ++size_;
+  return *target;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+T& SmallDeque<T, InlineN, Allocator, ChunkPolicy>::emplace_back(Args&&... args) {
+  if (heap_) {
+    return heap_->emplace_back(std::forward<Args>(args)...);
+  }
+  if (size_ == InlineN) {
+    T element(std::forward<Args>(args)...);
+    spill();
+    return heap_->emplace_back(std::move(element));
+  }
+  T* target = slot(size_);
+  AllocTraits::construct(allocator_, target, std::forward<Args>(args)...);
+  ++size_;
+  return *target;
+}
+
+// an inline element goes in at the nearer end and is rotated into place
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::emplace(iterator iter, Args&&... args) {
+  ssize_t index = iter - begin();
+  if (heap_) {
+    heap_->emplace(heap_->begin() + index, std::forward<Args>(args)...);
+  } else if (size_ == InlineN) {
+    T element(std::forward<Args>(args)...);
+    spill();
+    heap_->emplace(heap_->begin() + index, std::move(element));
+  } else if (size_t(index) < size_ / 2) {
+    emplace_front(std::forward<Args>(args)...);
+    std::rotate(begin(), begin() + 1, begin() + index + 1);
+  } else {
+    emplace_back(std::forward<Args>(args)...);
+    std::rotate(begin() + index, end() - 1, end());
+  }
+  return begin() + index;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::insert(iterator iter, const T& element) {
+  emplace(iter, element);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::insert(iterator iter, T&& element) {
+  emplace(iter, std::move(element));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::erase(iterator iter) {
+  if (size() == 0) {
+    throw std::out_of_range("deque is empty");
+  } else if (iter < begin() || iter >= end()) {
+    throw std::out_of_range("out of range");
+  }
+  return erase(iter, iter + 1);
+}
+
+// inline elements close the gap from the shorter side
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::erase(iterator first, iterator last) {
+  ssize_t index = first - begin();
+  if (heap_) {
+    heap_->erase(heap_->begin() + index, heap_->begin() + (last - begin()));
+    return begin() + index;
+  }
+  size_t count = last - first;
+  if (count == 0) {
+    // the shifts below would move the elements on one side onto themselves
+    return first;
+  }
+  if (size_t(index) < size_ - index - count) {
+    std::move_backward(begin(), first, last);
+    for (size_t i = 0; i < count; ++i) {
+      AllocTraits::destroy(allocator_, slot(i));
+    }
+    head_ = (head_ + count) & MASK_;
+  } else {
+    std::move(last, end(), first);
+    for (size_t i = size_ - count; i < size_; ++i) {
+      AllocTraits::destroy(allocator_, slot(i));
+    }
+  }
+  size_ -= count;
+  return begin() + index;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::pop_front() {
+  if (heap_) {
+    heap_->pop_front();
+    return;
+  }
+  if (size_ == 0) {
+    throw std::out_of_range("deque is empty");
+  }
+  AllocTraits::destroy(allocator_, slot(0));
+  head_ = (head_ + 1) & MASK_;
+  --size_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::pop_back() {
+  if (heap_) {
+    heap_->pop_back();
+    return;
+  }
+  if (size_ == 0) {
+    throw std::out_of_range("deque is empty");
+  }
+  AllocTraits::destroy(allocator_, slot(size_ - 1));
+  --size_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::clear() noexcept {
+  if (heap_) {
+    heap_->clear();
+  } else {
+    destroy_inline();
+  }
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::segment_view
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::segments() noexcept {
+  return segments(0, size());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_segment_view
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::segments() const noexcept {
+  return segments(0, size());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::segment_view
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::segments(size_t first, size_t last) noexcept {
+  size_t index = first_index();
+  return segment_view(first_node(), index + first, index + last, shift());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_segment_view
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::segments(size_t first, size_t last) const noexcept {
+  size_t index = first_index();
+  return const_segment_view(first_node(), index + first, index + last, shift());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::for_each_segment(Func&& func) {
+  for_each_segment(0, size(), std::forward<Func>(func));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::for_each_segment(Func&& func) const {
+  for_each_segment(0, size(), std::forward<Func>(func));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::for_each_segment(size_t first, size_t last, Func&& func) {
+  for (segment chunk: segments(first, last)) {
+    func(chunk);
+  }
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<typename Func>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::for_each_segment(size_t first, size_t last, Func&& func) const {
+  for (const_segment chunk: segments(first, last)) {
+    func(chunk);
+  }
+}
+
+// the walk of Deque's iterator, with the chunk size of the layout the iterator was made in
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+class SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator {
+ private:
+  T* const* node_ = nullptr;
+  T* first_ = nullptr;
+  size_t index_ = 0;
+  size_t shift_ = 0;
+
+  void set_node(T* const*) noexcept;
+
+ public:
+  CommonIterator() = default;
+
+  // position counts slots from the start of node
+  CommonIterator(T* const* node, size_t position, size_t shift) noexcept;
+
+  using value_type = T;
+  using iterator_category = std::random_access_iterator_tag;
+  using difference_type = ssize_t;
+  using reference = typename std::conditional<is_const, const T&, T&>::type;
+  using pointer = typename std::conditional<is_const, const T*, T*>::type;
+
+  operator CommonIterator<true>() const noexcept;
+
+  const CommonIterator<is_const> operator--(int) noexcept;
+  const CommonIterator<is_const> operator++(int) noexcept;
+  CommonIterator<is_const>& operator--() noexcept;
+  CommonIterator<is_const>& operator++() noexcept;
+  CommonIterator<is_const>& operator+=(difference_type) noexcept;
+  CommonIterator<is_const>& operator-=(difference_type) noexcept;
+  CommonIterator<is_const> operator+(difference_type) const noexcept;
+  CommonIterator<is_const> operator-(difference_type) const noexcept;
+
+  reference operator*() const;
+  pointer operator->() const;
+  reference operator[](difference_type) const;
+
+  difference_type operator-(const CommonIterator<is_const>&) const noexcept;
+  bool operator<(const CommonIterator<is_const>&) const noexcept;
+  bool operator==(const CommonIterator<is_const>&) const noexcept;
+  bool operator>(const CommonIterator<is_const>&) const noexcept;
+  bool operator<=(const CommonIterator<is_const>&) const noexcept;
+  bool operator>=(const CommonIterator<is_const>&) const noexcept;
+  bool operator!=(const CommonIterator<is_const>&) const noexcept;
+};
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::CommonIterator(T* const* node, size_t position,
+                                                                                         size_t shift) noexcept
+    : index_(position & ((size_t(1) << shift) - 1)), shift_(shift) {
+  set_node(node + (position >> shift));
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+void SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::set_node(T* const* node) noexcept {
+  node_ = node;
+  first_ = *node;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
+  return CommonIterator<true>(node_, index_, shift_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+const typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator--(int) noexcept {
+  CommonIterator temp_iterator(*this);
+  --(*this);
+  return temp_iterator;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+const typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator++(int) noexcept {
+  CommonIterator temp_iterator(*this);
+  ++(*this);
+  return temp_iterator;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator--() noexcept {
+  if (index_ == 0) {
+    set_node(node_ - 1);
+    index_ = size_t(1) << shift_;
+  }
+  --index_;
+  return *this;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator++() noexcept {
+  if (++index_ == size_t(1) << shift_) {
+    set_node(node_ + 1);
+    index_ = 0;
+  }
+  return *this;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator+=(difference_type delta) noexcept {
+  difference_type position = difference_type(index_) + delta;
+  size_t chunk_size = size_t(1) << shift_;
+  if (position < 0 || position >= difference_type(chunk_size)) {
+    // floor division by a power of two, also for negative positions
+    difference_type node_shift = position >= 0 ? position >> shift_ : -((-position - 1) >> shift_) - 1;
+    set_node(node_ + node_shift);
+  }
+  index_ = size_t(position) & (chunk_size - 1);
+  return *this;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>&
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator-=(difference_type delta) noexcept {
+  return (*this) += (-delta);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator+(difference_type delta) const noexcept {
+  CommonIterator<is_const> result(*this);
+  return result += delta;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator-(difference_type delta) const noexcept {
+  CommonIterator<is_const> result(*this);
+  return result -= delta;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>::reference
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator*() const {
+  return *std::launder(first_ + index_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>::pointer
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator->() const {
+  return std::launder(first_ + index_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>::reference
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator[](difference_type delta) const {
+  return *((*this) + delta);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonIterator<is_const>::difference_type
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator-(
+    const CommonIterator<is_const>& other) const noexcept {
+  return (node_ - other.node_) * (difference_type(1) << shift_) + difference_type(index_) - difference_type(other.index_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator<(
+    const CommonIterator<is_const>& other) const noexcept {
+  return node_ < other.node_ || (node_ == other.node_ && index_ < other.index_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator==(
+    const CommonIterator<is_const>& other) const noexcept {
+  return node_ == other.node_ && index_ == other.index_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator>(
+    const CommonIterator<is_const>& other) const noexcept {
+  return other < *this;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator<=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(other < *this);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator>=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this < other);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonIterator<is_const>::operator!=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this == other);
+}
+
+// walks the slots [position_, last_) counted from node_ one chunk at a time, the first and the last span may
+// be partial
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+class SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentIterator {
+ private:
+  T* const* node_;
+  size_t position_;
+  size_t last_;
+  size_t shift_;
+
+ public:
+  CommonSegmentIterator(T* const* node, size_t position, size_t last, size_t shift) noexcept;
+
+  using value_type = typename std::conditional<is_const, std::span<const T>, std::span<T>>::type;
+  using iterator_category = std::forward_iterator_tag;
+  using difference_type = ssize_t;
+
+  value_type operator*() const noexcept;
+  CommonSegmentIterator<is_const>& operator++() noexcept;
+  CommonSegmentIterator<is_const> operator++(int) noexcept;
+  bool operator==(const CommonSegmentIterator<is_const>&) const noexcept;
+  bool operator!=(const CommonSegmentIterator<is_const>&) const noexcept;
+};
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::CommonSegmentIterator(
+    T* const* node, size_t position, size_t last, size_t shift) noexcept
+    : node_(node), position_(position), last_(last), shift_(shift) {}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonSegmentIterator<is_const>::value_type
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator*() const noexcept {
+  size_t mask = (size_t(1) << shift_) - 1;
+  size_t chunk_end = (position_ | mask) + 1;
+  return value_type(std::launder(node_[position_ >> shift_] + (position_ & mask)),
+                    std::min(chunk_end, last_) - position_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonSegmentIterator<is_const>&
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator++() noexcept {
+  position_ = std::min((position_ | ((size_t(1) << shift_) - 1)) + 1, last_);
+  return *this;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonSegmentIterator<is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator++(int) noexcept {
+  CommonSegmentIterator temp_iterator(*this);
+  ++(*this);
+  return temp_iterator;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator==(
+    const CommonSegmentIterator<is_const>& other) const noexcept {
+  return position_ == other.position_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentIterator<is_const>::operator!=(
+    const CommonSegmentIterator<is_const>& other) const noexcept {
+  return !(*this == other);
+}
+
+// contiguous pieces of a slot range, valid until the next insertion or erasure
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+class SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentView {
+ private:
+  T* const* node_;
+  size_t first_;
+  size_t last_;
+  size_t shift_;
+
+ public:
+  CommonSegmentView(T* const* node, size_t first, size_t last, size_t shift) noexcept;
+
+  using iterator = CommonSegmentIterator<is_const>;
+
+  iterator begin() const noexcept;
+  iterator end() const noexcept;
+  size_t size() const noexcept;
+  bool empty() const noexcept;
+};
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::CommonSegmentView(
+    T* const* node, size_t first, size_t last, size_t shift) noexcept
+    : node_(node), first_(first), last_(last), shift_(shift) {}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonSegmentView<is_const>::iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::begin() const noexcept {
+  return iterator(node_, first_, last_, shift_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::template CommonSegmentView<is_const>::iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::end() const noexcept {
+  return iterator(node_, last_, last_, shift_);
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+size_t SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::size() const noexcept {
+  return first_ == last_ ? 0 : ((last_ - 1) >> shift_) - (first_ >> shift_) + 1;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+template<bool is_const>
+bool SmallDeque<T, InlineN, Allocator, ChunkPolicy>::CommonSegmentView<is_const>::empty() const noexcept {
+  return first_ == last_;
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::begin() noexcept {
+  return iterator(first_node(), first_index(), shift());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::begin() const noexcept {
+  return const_iterator(first_node(), first_index(), shift());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::end() noexcept {
+  return iterator(first_node(), first_index() + size(), shift());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::end() const noexcept {
+  return const_iterator(first_node(), first_index() + size(), shift());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::cbegin() const noexcept {
+  return begin();
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::cend() const noexcept {
+  return end();
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::reverse_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::rbegin() noexcept {
+  return reverse_iterator(end());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_reverse_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::rbegin() const noexcept {
+  return const_reverse_iterator(end());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_reverse_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::crbegin() const noexcept {
+  return const_reverse_iterator(end());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::reverse_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::rend() noexcept {
+  return reverse_iterator(begin());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_reverse_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::rend() const noexcept {
+  return const_reverse_iterator(begin());
+}
+
+template<typename T, size_t InlineN, typename Allocator, typename ChunkPolicy>
+typename SmallDeque<T, InlineN, Allocator, ChunkPolicy>::const_reverse_iterator
+SmallDeque<T, InlineN, Allocator, ChunkPolicy>::crend() const noexcept {
+  return const_reverse_iterator(begin());
+}
@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "small_deque.h"
+
+struct Counted {
+  static int alive;
+
+  int x = 0;
+
+  Counted(int x) : x(x) { ++alive; }
+  Counted(const Counted& other) : x(other.x) { ++alive; }
+  Counted& operator=(const Counted& other) = default;
+  ~Counted() { --alive; }
+};
+
+int Counted::alive = 0;
+
+template<typename T>
+struct CountingAllocator {
+  static size_t calls;
+
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template<typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    ++calls;
+    return std::allocator<T>().allocate(count);
+  }
+
+  void deallocate(T* pointer, size_t count) {
+    ++calls;
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  template<typename U>
+  bool operator==(const CountingAllocator<U>&) const { return true; }
+};
+
+template<typename T>
+size_t CountingAllocator<T>::calls = 0;
+
+// copies throw once armed, and there is no move to fall back on
+struct Fragile {
+  static bool armed;
+
+  int x = 0;
+
+  Fragile(int x) : x(x) {}
+  Fragile(const Fragile& other) : x(other.x) {
+    if (armed) {
+      throw std::runtime_error("copy");
+    }
+  }
+};
+
+bool Fragile::armed = false;
+
+// a stateful allocator that stays with its deque: allocations are counted per id
+template<typename T>
+struct TaggedAllocator {
+  static std::map<int, int> live;
+
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+
+  int id = 0;
+
+  explicit TaggedAllocator(int id = 0) : id(id) {}
+  template<typename U>
+  TaggedAllocator(const TaggedAllocator<U>& other) : id(other.id) {}
+
+  T* allocate(size_t count) {
+    ++live[id];
+    return std::allocator<T>().allocate(count);
+  }
+
+  void deallocate(T* pointer, size_t count) {
+    --live[id];
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  template<typename U>
+  bool operator==(const TaggedAllocator<U>& other) const { return id == other.id; }
+};
+
+template<typename T>
+std::map<int, int> TaggedAllocator<T>::live;
+
+template<typename Small>
+void CheckSame(const Small& small, const std::deque<int>& reference) {
+  assert(small.size() == reference.size());
+  assert(std::equal(small.begin(), small.end(), reference.begin(), reference.end()));
+  assert(std::equal(small.rbegin(), small.rend(), reference.rbegin(), reference.rend()));
+}
+
+void test1() {
+  // a deque that stays within its inline slots never allocates, wherever the ring wraps
+  using Small = SmallDeque<int, 8, CountingAllocator<int>>;
+  CountingAllocator<int>::calls = 0;
+  CountingAllocator<int*>::calls = 0;
+  {
+    Small d;
+    std::deque<int> reference;
+    for (int i = 0; i < 100; ++i) {
+      d.push_back(i);
+      reference.push_back(i);
+      if (d.size() > 5) {
+        d.pop_front();
+        reference.pop_front();
+      }
+      CheckSame(d, reference);
+    }
+    for (int i = 0; i < 3; ++i) {
+      d.emplace_front(-i);
+      reference.push_front(-i);
+    }
+    CheckSame(d, reference);
+    assert(d.is_inline() && d.size() == 8 && d.front() == -2 && d.back() == 99);
+    assert(d[3] == 95 && d.at(7) == 99);
+    bool thrown = false;
+    try {
+      d.at(8);
+    } catch (const std::out_of_range&) {
+      thrown = true;
+    }
+    assert(thrown);
+    std::sort(d.begin(), d.end());
+    std::sort(reference.begin(), reference.end());
+    CheckSame(d, reference);
+    Small copy(d);
+    Small moved(std::move(copy));
+    assert(copy.size() == 0 && copy.is_inline());
+    CheckSame(moved, reference);
+    d.clear();
+    assert(d.size() == 0);
+    thrown = false;
+    try {
+      d.pop_back();
+    } catch (const std::out_of_range&) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+  assert(CountingAllocator<int>::calls == 0 && CountingAllocator<int*>::calls == 0);
+
+  // the push past InlineN moves everything to the heap layout, at either end
+  for (int front_side = 0; front_side < 2; ++front_side) {
+    Small d;
+    std::deque<int> reference;
+    for (int i = 0; i < 8; ++i) {
+      d.push_front(i);
+      reference.push_front(i);
+    }
+    d.pop_back();
+    reference.pop_back();
+    d.push_front(100);
+    reference.push_front(100);
+    assert(d.is_inline());
+    if (front_side) {
+      d.push_front(d.back());
+      reference.push_front(reference.back());
+    } else {
+      d.push_back(d.front());
+      reference.push_back(reference.front());
+    }
+    assert(!d.is_inline() && CountingAllocator<int>::calls > 0);
+    CheckSame(d, reference);
+    for (int i = 0; i < 1000; ++i) {
+      d.push_back(i);
+      reference.push_back(i);
+    }
+    while (d.size() > 2) {
+      d.pop_front();
+      reference.pop_front();
+    }
+    CheckSame(d, reference);
+    assert(!d.is_inline());
+    Small copy(d);
+    assert(copy.is_inline());
+    CheckSame(copy, reference);
+  }
+}
+
+void test2() {
+  std::mt19937 generator(24);
+  using Small = SmallDeque<Counted, 6>;
+  {
+    Small d;
+    std::deque<int> reference;
+    for (int step = 0; step < 20'000; ++step) {
+      int value = int(generator() % 1000);
+      switch (generator() % 5) {
+        case 0:
+          d.emplace_back(value);
+          reference.push_back(value);
+          break;
+        case 1:
+          d.push_front(Counted(value));
+          reference.push_front(value);
+          break;
+        case 2:
+          if (!reference.empty()) {
+            d.pop_back();
+            reference.pop_back();
+          }
+          break;
+        case 3:
+          if (!reference.empty()) {
+            d.pop_front();
+            reference.pop_front();
+          }
+          break;
+        default:
+          if (step % 100 == 0) {
+            d.clear();
+            reference.clear();
+          }
+      }
+      assert(d.size() == reference.size() && Counted::alive == int(reference.size()));
+      for (size_t i = 0; i < reference.size(); ++i) {
+        assert(d[i].x == reference[i]);
+      }
+    }
+  }
+  assert(Counted::alive == 0);
+
+  // copies, moves and swaps between the two layouts
+  {
+    Small small;
+    Small big;
+    for (int i = 0; i < 4; ++i) {
+      small.emplace_back(i);
+    }
+    for (int i = 0; i < 50; ++i) {
+      big.emplace_back(100 + i);
+    }
+    swap(small, big);
+    assert(small.size() == 50 && !small.is_inline() && small[49].x == 149);
+    assert(big.size() == 4 && big.is_inline() && big[3].x == 3);
+    Small copy;
+    copy = small;
+    assert(copy.size() == 50 && copy[0].x == 100);
+    copy = big;
+    assert(copy.size() == 4 && copy.is_inline() && copy[3].x == 3);
+    small = std::move(copy);
+    assert(small.is_inline() && small.size() == 4 && copy.size() == 0);
+    assert(Counted::alive == 8);
+  }
+  assert(Counted::alive == 0);
+
+  // a spill that throws leaves the inline elements where they were
+  SmallDeque<Fragile, 4> d;
+  for (int i = 0; i < 4; ++i) {
+    d.emplace_back(i);
+  }
+  Fragile::armed = true;
+  bool thrown = false;
+  try {
+    d.emplace_back(4);
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  Fragile::armed = false;
+  assert(thrown && d.is_inline() && d.size() == 4 && d[0].x == 0 && d[3].x == 3);
+  d.emplace_back(4);
+  assert(!d.is_inline() && d.size() == 5 && d[4].x == 4);
+
+  SmallDeque<std::string, 2> words;
+  words.push_back(std::string(100, 'a'));
+  words.push_front("b");
+  words.push_back(words.front());
+  assert(words.size() == 3 && words[2] == "b" && words[1].size() == 100);
+}
+
+void test3() {
+  // insert and erase in the middle, in both layouts and around the spill
+  std::mt19937 generator(3);
+  {
+    SmallDeque<int, 6> d;
+    std::deque<int> reference;
+    for (int step = 0; step < 20'000; ++step) {
+      int value = int(generator() % 1000);
+      size_t index = reference.empty() ? 0 : generator() % (reference.size() + 1);
+      switch (generator() % 6) {
+        case 0:
+          d.insert(d.begin() + index, value);
+          reference.insert(reference.begin() + index, value);
+          break;
+        case 1:
+          assert(*d.emplace(d.begin() + index, value) == value);
+          reference.insert(reference.begin() + index, value);
+          break;
+        case 2:
+          if (index < reference.size()) {
+            auto it = d.erase(d.begin() + index);
+            reference.erase(reference.begin() + index);
+            assert(it - d.begin() == ssize_t(index));
+          }
+          break;
+        case 3: {
+          size_t last = std::min(reference.size(), index + generator() % 4);
+          d.erase(d.begin() + index, d.begin() + last);
+          reference.erase(reference.begin() + index, reference.begin() + last);
+          break;
+        }
+        case 4:
+          if (!reference.empty()) {
+            d.pop_front();
+            reference.pop_front();
+          }
+          d.push_back(value);
+          reference.push_back(value);
+          break;
+        default:
+          if (step % 50 == 0) {
+            d = SmallDeque<int, 6>();
+            reference.clear();
+          }
+      }
+      CheckSame(d, reference);
+      std::vector<int> joined;
+      size_t pieces = 0;
+      d.for_each_segment([&](std::span<const int> chunk) {
+        assert(!chunk.empty());
+        joined.insert(joined.end(), chunk.begin(), chunk.end());
+        ++pieces;
+      });
+      assert(pieces == d.segments().size());
+      assert(std::equal(joined.begin(), joined.end(), reference.begin(), reference.end()));
+      if (d.is_inline()) {
+        assert(pieces <= 2);
+      }
+    }
+  }
+
+  // erasing an empty range leaves every element alone, inline and on the heap
+  for (int elements: {6, 20}) {
+    SmallDeque<std::vector<int>, 6> d;
+    for (int i = 0; i < elements; ++i) {
+      d.push_back(std::vector<int>(3, i));
+    }
+    assert(d.is_inline() == (elements == 6));
+    for (ssize_t index: {ssize_t(0), ssize_t(1), ssize_t(5), ssize_t(elements)}) {
+      auto it = d.erase(d.begin() + index, d.begin() + index);
+      assert(it - d.begin() == index && d.size() == size_t(elements));
+    }
+    for (int i = 0; i < elements; ++i) {
+      assert(d[i] == std::vector<int>(3, i));
+    }
+  }
+
+  // a wrapped inline ring comes out as two spans
+  {
+    SmallDeque<int, 4> d;
+    d.push_back(1);
+    d.push_back(2);
+    d.push_front(0);
+    std::vector<size_t> sizes;
+    for (std::span<int> chunk: d.segments()) {
+      sizes.push_back(chunk.size());
+    }
+    assert(d.is_inline() && sizes == std::vector<size_t>({1, 2}));
+    const SmallDeque<int, 4>& view = d;
+    sizes.clear();
+    for (std::span<const int> chunk: view.segments(1, 3)) {
+      sizes.push_back(chunk.size());
+      assert(chunk[0] == 1);
+    }
+    assert(sizes == std::vector<size_t>({2}));
+  }
+
+  // two heap deques swap without touching an element or the allocator
+  {
+    using Small = SmallDeque<int, 4, CountingAllocator<int>>;
+    Small left;
+    Small right;
+    for (int i = 0; i < 100; ++i) {
+      left.push_back(i);
+      right.push_front(i);
+    }
+    CountingAllocator<int>::calls = 0;
+    CountingAllocator<int*>::calls = 0;
+    const int* first = &left.front();
+    left.swap(right);
+    assert(CountingAllocator<int>::calls == 0 && CountingAllocator<int*>::calls == 0);
+    assert(&right.front() == first && left.front() == 99 && right.back() == 99);
+  }
+
+  // inline deques of different sizes swap element by element
+  {
+    SmallDeque<Counted, 6> left;
+    SmallDeque<Counted, 6> right;
+    for (int i = 0; i < 5; ++i) {
+      left.emplace_front(i);
+    }
+    right.emplace_back(10);
+    swap(left, right);
+    assert(left.size() == 1 && left[0].x == 10 && right.size() == 5 && right[0].x == 4 && right[4].x == 0);
+    assert(Counted::alive == 6);
+  }
+  assert(Counted::alive == 0);
+
+  // a move into a deque with an unequal allocator that does not propagate moves the elements instead
+  {
+    using Tagged = TaggedAllocator<int>;
+    using Small = SmallDeque<int, 4, Tagged>;
+    Small source{Tagged(1)};
+    Small target{Tagged(2)};
+    for (int i = 0; i < 50; ++i) {
+      source.push_back(i);
+    }
+    target.push_back(-1);
+    target = std::move(source);
+    assert(target.get_allocator().id == 2 && target.size() == 50 && target[49] == 49);
+    assert(TaggedAllocator<int>::live[2] > 0);
+    source.clear();
+    Small same{Tagged(2)};
+    same = std::move(target);
+    assert(same.size() == 50 && same[0] == 0);
+  }
+  assert(TaggedAllocator<int>::live[1] == 0 && TaggedAllocator<int>::live[2] == 0);
+  assert(TaggedAllocator<int*>::live[1] == 0 && TaggedAllocator<int*>::live[2] == 0);
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Test 2 passed.\n";
+
+  test3();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "deque.h"
+
+// single producer / single consumer queue over a ring of Deque-sized chunks;
+// push_back belongs to one thread and try_pop_front to another, they meet only at head_ and tail_
+template<typename T, typename Allocator = std::allocator<T>, typename ChunkPolicy = SmallChunkPolicy>
+class SpscDeque {
+ private:
+  static constexpr size_t MAX_SIZE_ = ChunkPolicy::template chunk_size<T>();
+  static constexpr size_t SHIFT_ = chunk_shift(MAX_SIZE_);
+  static constexpr size_t MASK_ = MAX_SIZE_ - 1;
+  static constexpr size_t CACHE_LINE_ = 64;
+
+  struct Chunk {
+    Chunk* next = nullptr;
+    alignas(T) unsigned char storage[MAX_SIZE_ * sizeof(T)];
+
+    T* slot(size_t index) noexcept {
+      return std::launder(reinterpret_cast<T*>(storage) + index);
+    }
+  };
+
+  using chunk_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<Chunk>;
+  using ChunkAllocTraits = std::allocator_traits<chunk_allocator_type>;
+  using element_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  using AllocTraits = std::allocator_traits<element_allocator_type>;
+
+  chunk_allocator_type chunk_allocator_;
+  element_allocator_type allocator_;
+  size_t chunk_count_ = 1; // chunks in the ring, touched by the producer only
+
+  // consumer side
+  alignas(CACHE_LINE_) std::atomic<size_t> head_{0};
+  Chunk* head_chunk_;
+  size_t cached_tail_ = 0;
+
+  // producer side
+  alignas(CACHE_LINE_) std::atomic<size_t> tail_{0};
+  Chunk* tail_chunk_;
+  size_t cached_head_ = 0;
+
+  Chunk* allocate_chunk();
+  T* prepare_back();
+  size_t chunks_in_use(size_t tail, size_t head) const noexcept;
+
+ public:
+  SpscDeque();
+  explicit SpscDeque(const Allocator&);
+  SpscDeque(const SpscDeque<T, Allocator, ChunkPolicy>&) = delete;
+  SpscDeque<T, Allocator, ChunkPolicy>& operator=(const SpscDeque<T, Allocator, ChunkPolicy>&) = delete;
+  ~SpscDeque() noexcept;
+
+  // producer thread
+  void push_back(const T&);
+  void push_back(T&&);
+  template<typename... Args>
+  void emplace_back(Args&&...);
+
+  // consumer thread
+  bool try_pop_front(T&);
+  T* front() noexcept;
+
+  // a snapshot, exact only when both threads are idle
+  size_t size() const noexcept;
+  bool empty() const noexcept;
+};
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+SpscDeque<T, Allocator, ChunkPolicy>::SpscDeque() : SpscDeque<T, Allocator, ChunkPolicy>(Allocator()) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+SpscDeque<T, Allocator, ChunkPolicy>::SpscDeque(const Allocator& allocator)
+    : chunk_allocator_(allocator), allocator_(allocator) {
+  head_chunk_ = tail_chunk_ = allocate_chunk();
+  head_chunk_->next = head_chunk_;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+SpscDeque<T, Allocator, ChunkPolicy>::~SpscDeque() noexcept {
+  size_t head = head_.load(std::memory_order_relaxed);
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  Chunk* chunk = head_chunk_;
+  for (; head != tail; ++head) {
+    if ((head & MASK_) == 0 && head != 0) {
+      chunk = chunk->next;
+    }
+    AllocTraits::destroy(allocator_, chunk->slot(head & MASK_));
+  }
+  Chunk* first = tail_chunk_;
+  chunk = first;
+  do {
+    Chunk* next = chunk->next;
+    ChunkAllocTraits::destroy(chunk_allocator_, chunk);
+    ChunkAllocTraits::deallocate(chunk_allocator_, chunk, 1);
+    chunk = next;
+  } while (chunk != first);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename SpscDeque<T, Allocator, ChunkPolicy>::Chunk* SpscDeque<T, Allocator, ChunkPolicy>::allocate_chunk() {
+  Chunk* chunk = ChunkAllocTraits::allocate(chunk_allocator_, 1);
+  ChunkAllocTraits::construct(chunk_allocator_, chunk);
+  return chunk;
+}
+
+// the consumer steps off a chunk only when it reads the next element, so the chunk it has just
+// emptied still counts as in use: its next pointer is the one the consumer will follow
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t SpscDeque<T, Allocator, ChunkPolicy>::chunks_in_use(size_t tail, size_t head) const noexcept {
+  size_t head_chunk = head == 0 ? 0 : (head - 1) >> SHIFT_;
+  return (tail >> SHIFT_) - head_chunk + 1;
+}
+
+// returns the slot at tail_, stepping into the next chunk of the ring or splicing a new one in
+template<typename T, typename Allocator, typename ChunkPolicy>
+T* SpscDeque<T, Allocator, ChunkPolicy>::prepare_back() {
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  if ((tail & MASK_) == 0 && tail != 0) {
+    // the next chunk is free once the consumer has left it; acquire pairs with the release in try_pop_front
+    if (chunks_in_use(tail, cached_head_) > chunk_count_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    if (chunks_in_use(tail, cached_head_) > chunk_count_) {
+      // the consumer reads tail_chunk_->next only after the tail passes this chunk, so a plain store is enough
+      Chunk* chunk = allocate_chunk();
+      chunk->next = tail_chunk_->next;
+      tail_chunk_->next = chunk;
+      ++chunk_count_;
+    }
+    tail_chunk_ = tail_chunk_->next;
+  }
+  return tail_chunk_->slot(tail & MASK_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+template<typename... Args>
+void SpscDeque<T, Allocator, ChunkPolicy>::emplace_back(Args&&... args) {
+  T* slot = prepare_back();
+  AllocTraits::construct(allocator_, slot, std::forward<Args>(args)...);
+  // publishes the element and any chunk spliced in for it
+  tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void SpscDeque<T, Allocator, ChunkPolicy>::push_back(const T& element) {
+  emplace_back(element);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void SpscDeque<T, Allocator, ChunkPolicy>::push_back(T&& element) {
+  emplace_back(std::move(element));
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+T* SpscDeque<T, Allocator, ChunkPolicy>::front() noexcept {
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head == cached_tail_) {
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+    if (head == cached_tail_) {
+      return nullptr;
+    }
+  }
+  // head_chunk_ moves on lazily, so at a chunk boundary it still points at the chunk just emptied
+  Chunk* chunk = ((head & MASK_) == 0 && head != 0) ? head_chunk_->next : head_chunk_;
+  return chunk->slot(head & MASK_);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+bool SpscDeque<T, Allocator, ChunkPolicy>::try_pop_front(T& element) {
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head == cached_tail_) {
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+    if (head == cached_tail_) {
+      return false;
+    }
+  }
+  // head_chunk_ moves on only once the element is out, a throwing assignment leaves it at the front
+  Chunk* chunk = ((head & MASK_) == 0 && head != 0) ? head_chunk_->next : head_chunk_;
+  T* slot = chunk->slot(head & MASK_);
+  element = std::move(*slot);
+  head_chunk_ = chunk;
+  AllocTraits::destroy(allocator_, slot);
+  // hands the slot, and once the chunk is left the whole chunk, back to the producer
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t SpscDeque<T, Allocator, ChunkPolicy>::size() const noexcept {
+  size_t head = head_.load(std::memory_order_acquire);
+  size_t tail = tail_.load(std::memory_order_acquire);
+  return tail > head ? tail - head : 0;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+bool SpscDeque<T, Allocator, ChunkPolicy>::empty() const noexcept {
+  return size() == 0;
+}
@@ -0,0 +1,167 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_deque.h"
+
+struct Counted {
+  static int alive;
+
+  int x = 0;
+
+  Counted(int x) : x(x) { ++alive; }
+  Counted(const Counted& other) : x(other.x) { ++alive; }
+  Counted& operator=(const Counted& other) = default;
+  ~Counted() { --alive; }
+};
+
+int Counted::alive = 0;
+
+// assignment throws for one marked value
+struct Picky {
+  static int refused;
+
+  int x = 0;
+
+  Picky(int x) : x(x) {}
+  Picky(const Picky&) = default;
+  Picky& operator=(const Picky& other) {
+    if (other.x == refused) {
+      throw std::runtime_error("assign");
+    }
+    x = other.x;
+    return *this;
+  }
+};
+
+int Picky::refused = -1;
+
+void test1() {
+  SpscDeque<int, std::allocator<int>, FixedChunkPolicy<4>> q;
+  int value = -1;
+  assert(q.empty() && !q.try_pop_front(value) && q.front() == nullptr);
+
+  // crosses chunk boundaries while the ring both grows and gets reused
+  int next_push = 0;
+  int next_pop = 0;
+  for (int round = 0; round < 100; ++round) {
+    for (int i = 0; i < round % 13 + 1; ++i) {
+      q.push_back(next_push++);
+    }
+    assert(q.size() == size_t(next_push - next_pop));
+    for (int i = 0; i < round % 11 + 1 && next_pop < next_push; ++i) {
+      assert(*q.front() == next_pop);
+      assert(q.try_pop_front(value) && value == next_pop++);
+    }
+  }
+  while (q.try_pop_front(value)) {
+    assert(value == next_pop++);
+  }
+  assert(next_pop == next_push && q.empty());
+
+  {
+    SpscDeque<Counted, std::allocator<Counted>, FixedChunkPolicy<8>> counted;
+    for (int i = 0; i < 30; ++i) {
+      counted.emplace_back(i);
+    }
+    Counted popped(0);
+    for (int i = 0; i < 10; ++i) {
+      assert(counted.try_pop_front(popped) && popped.x == i);
+    }
+    assert(Counted::alive == 21);
+  }
+  assert(Counted::alive == 0);
+
+  SpscDeque<std::string> strings;
+  strings.push_back(std::string(100, 'x'));
+  strings.emplace_back("short");
+  std::string s;
+  assert(strings.try_pop_front(s) && s == std::string(100, 'x'));
+  assert(strings.try_pop_front(s) && s == "short");
+}
+
+template<typename ChunkPolicy>
+void CheckTransfer(size_t count) {
+  SpscDeque<size_t, std::allocator<size_t>, ChunkPolicy> q;
+  std::vector<size_t> received;
+  received.reserve(count);
+  std::thread consumer([&] {
+    size_t value = 0;
+    while (received.size() < count) {
+      if (q.try_pop_front(value)) {
+        received.push_back(value);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (size_t i = 0; i < count; ++i) {
+    q.push_back(i);
+    if (i % 4096 == 0) {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  for (size_t i = 0; i < count; ++i) {
+    assert(received[i] == i);
+  }
+  assert(q.empty());
+}
+
+void test2() {
+  // a pop that throws at a chunk boundary leaves the element at the front
+  SpscDeque<Picky, std::allocator<Picky>, FixedChunkPolicy<4>> picky;
+  for (int i = 0; i < 12; ++i) {
+    picky.push_back(Picky(i));
+  }
+  Picky out(-1);
+  Picky::refused = 4;
+  for (int expected = 0; expected < 12; ++expected) {
+    if (expected == 4) {
+      bool thrown = false;
+      try {
+        picky.try_pop_front(out);
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+      assert(thrown && picky.front()->x == 4);
+      Picky::refused = -1;
+    }
+    assert(picky.try_pop_front(out) && out.x == expected);
+  }
+
+  CheckTransfer<FixedChunkPolicy<2>>(200'000);
+  CheckTransfer<FixedChunkPolicy<64>>(1'000'000);
+  CheckTransfer<SmallChunkPolicy>(2'000'000);
+
+  // heap-owning elements must arrive intact
+  SpscDeque<std::vector<int>> q;
+  const int kCount = 100'000;
+  std::thread producer([&] {
+    for (int i = 0; i < kCount; ++i) {
+      q.emplace_back(i % 17, i);
+    }
+  });
+  std::vector<int> v;
+  for (int i = 0; i < kCount; ++i) {
+    while (!q.try_pop_front(v)) {
+      std::this_thread::yield();
+    }
+    assert(v == std::vector<int>(i % 17, i));
+  }
+  producer.join();
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -0,0 +1,724 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// deque with the interface of Deque and no heap at all: up to N elements in slots inside the object, a ring
+// of bit_ceil(N) of them, element i at slots_[(head_ + i) & MASK_]. every member except segments() can be
+// used in constant expressions, where a push past N fails to compile
+template<typename T, size_t N>
+class StaticDeque {
+ private:
+  static_assert(N > 0, "a static deque needs at least one slot");
+  static_assert(N <= (size_t(1) << (sizeof(size_t) * 8 - 2)) / sizeof(T), "static deque capacity is too large");
+
+  static constexpr size_t SLOTS_ = std::bit_ceil(N);
+  static constexpr size_t MASK_ = SLOTS_ - 1;
+
+  // raw storage for one element like StackStorage<N>::storage_, but a union member can be constructed and
+  // destroyed during constant evaluation, where a reinterpret_cast byte array cannot
+  union Slot {
+    T value;
+
+    constexpr Slot() noexcept {}
+    constexpr ~Slot() {}
+  };
+
+  static_assert(sizeof(Slot) == sizeof(T), "slots must be laid out like an array of T");
+
+  Slot slots_[SLOTS_];
+  size_t head_ = 0; // slot of the first element, always below SLOTS_
+  size_t size_ = 0;
+
+  constexpr T& element(size_t) noexcept;
+  constexpr const T& element(size_t) const noexcept;
+  constexpr void check_room() const;
+
+  template<bool is_const>
+  class CommonIterator;
+
+ public:
+  constexpr StaticDeque() noexcept;
+  constexpr StaticDeque(int);
+  constexpr StaticDeque(int, const T&);
+  template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+  constexpr StaticDeque(InputIt, InputIt);
+  constexpr StaticDeque(const StaticDeque<T, N>&);
+  constexpr StaticDeque(StaticDeque<T, N>&&) noexcept(std::is_nothrow_move_constructible_v<T>);
+  constexpr ~StaticDeque() noexcept;
+
+  constexpr StaticDeque<T, N>& operator=(const StaticDeque<T, N>&);
+  constexpr StaticDeque<T, N>& operator=(StaticDeque<T, N>&&) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+  constexpr void swap(StaticDeque<T, N>&) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+  using iterator = CommonIterator<false>;
+  using const_iterator = CommonIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using segment = std::span<T>;
+  using const_segment = std::span<const T>;
+
+  static constexpr size_t capacity() noexcept;
+  constexpr size_t size() const noexcept;
+  constexpr bool full() const noexcept;
+  constexpr T& operator[](ssize_t);
+  constexpr const T& operator[](ssize_t) const;
+  constexpr T& at(ssize_t);
+  constexpr const T& at(ssize_t) const;
+  constexpr T& front();
+  constexpr const T& front() const;
+  constexpr T& back();
+  constexpr const T& back() const;
+
+  // a push into a full deque throws std::length_error and leaves it as it was
+  constexpr void push_front(const T&);
+  constexpr void push_front(T&&);
+  constexpr void push_back(const T&);
+  constexpr void push_back(T&&);
+  constexpr void pop_front();
+  constexpr void pop_back();
+  constexpr void clear() noexcept;
+
+  template<typename InputIt>
+  constexpr void append(InputIt, InputIt);
+  constexpr void resize(size_t);
+  constexpr void resize(size_t, const T&);
+
+  template<typename... Args>
+  constexpr T& emplace_front(Args&&...);
+  template<typename... Args>
+  constexpr T& emplace_back(Args&&...);
+  template<typename... Args>
+  constexpr iterator emplace(iterator, Args&&...);
+
+  constexpr void insert(iterator, const T&);
+  constexpr void insert(iterator, T&&);
+  constexpr iterator erase(iterator);
+  constexpr iterator erase(iterator, iterator);
+
+  constexpr iterator begin() noexcept;
+  constexpr const_iterator begin() const noexcept;
+  constexpr iterator end() noexcept;
+  constexpr const_iterator end() const noexcept;
+  constexpr const_iterator cbegin() const noexcept;
+  constexpr const_iterator cend() const noexcept;
+
+  constexpr reverse_iterator rbegin() noexcept;
+  constexpr const_reverse_iterator rbegin() const noexcept;
+  constexpr const_reverse_iterator crbegin() const noexcept;
+  constexpr reverse_iterator rend() noexcept;
+  constexpr const_reverse_iterator rend() const noexcept;
+  constexpr const_reverse_iterator crend() const noexcept;
+
+  // the elements in order as two contiguous pieces, the second one empty unless the ring wraps
+  std::array<segment, 2> segments() noexcept;
+  std::array<const_segment, 2> segments() const noexcept;
+
+  template<typename Func>
+  void for_each_segment(Func&&);
+  template<typename Func>
+  void for_each_segment(Func&&) const;
+};
+
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>::StaticDeque() noexcept {}
+
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>::StaticDeque(int count) : StaticDeque<T, N>() {
+  resize(size_t(count));
+}
+
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>::StaticDeque(int count, const T& element) : StaticDeque<T, N>() {
+  resize(size_t(count), element);
+}
+
+template<typename T, size_t N>
+template<typename InputIt, typename>
+constexpr StaticDeque<T, N>::StaticDeque(InputIt first, InputIt last) : StaticDeque<T, N>() {
+  append(first, last);
+}
+
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>::StaticDeque(const StaticDeque<T, N>& other) : StaticDeque<T, N>() {
+  append(other.begin(), other.end());
+}
+
+// the elements move one by one, other is left empty
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>::StaticDeque(StaticDeque<T, N>&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    : StaticDeque<T, N>() {
+  for (T& element: other) {
+    emplace_back(std::move(element));
+  }
+  other.clear();
+}
+
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>::~StaticDeque() noexcept {
+  clear();
+}
+
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>& StaticDeque<T, N>::operator=(const StaticDeque<T, N>& other) {
+  if (this != &other) {
+    StaticDeque<T, N> copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+template<typename T, size_t N>
+constexpr StaticDeque<T, N>& StaticDeque<T, N>::operator=(StaticDeque<T, N>&& other)
+    noexcept(std::is_nothrow_move_constructible_v<T>) {
+  if (this != &other) {
+    clear();
+    for (T& element: other) {
+      emplace_back(std::move(element));
+    }
+    other.clear();
+  }
+  return *this;
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::swap(StaticDeque<T, N>& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+  StaticDeque<T, N> moved(std::move(other));
+  other = std::move(*this);
+  *this = std::move(moved);
+}
+
+template<typename T, size_t N>
+constexpr void swap(StaticDeque<T, N>& left, StaticDeque<T, N>& right)
+    noexcept(std::is_nothrow_move_constructible_v<T>) {
+  left.swap(right);
+}
+
+template<typename T, size_t N>
+constexpr T& StaticDeque<T, N>::element(size_t index) noexcept {
+  return slots_[(head_ + index) & MASK_].value;
+}
+
+template<typename T, size_t N>
+constexpr const T& StaticDeque<T, N>::element(size_t index) const noexcept {
+  return slots_[(head_ + index) & MASK_].value;
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::check_room() const {
+  if (size_ == N) {
+    throw std::length_error("static deque is full");
+  }
+}
+
+template<typename T, size_t N>
+constexpr size_t StaticDeque<T, N>::capacity() noexcept {
+  return N;
+}
+
+template<typename T, size_t N>
+constexpr size_t StaticDeque<T, N>::size() const noexcept {
+  return size_;
+}
+
+template<typename T, size_t N>
+constexpr bool StaticDeque<T, N>::full() const noexcept {
+  return size_ == N;
+}
+
+template<typename T, size_t N>
+constexpr T& StaticDeque<T, N>::operator[](ssize_t index) {
+  return element(size_t(index));
+}
+
+template<typename T, size_t N>
+constexpr const T& StaticDeque<T, N>::operator[](ssize_t index) const {
+  return element(size_t(index));
+}
+
+template<typename T, size_t N>
+constexpr T& StaticDeque<T, N>::at(ssize_t index) {
+  if (index < 0 || index >= ssize_t(size_)) {
+    throw std::out_of_range("out of range");
+  } else {
+    return element(size_t(index));
+  }
+}
+
+template<typename T, size_t N>
+constexpr const T& StaticDeque<T, N>::at(ssize_t index) const {
+  if (index < 0 || index >= ssize_t(size_)) {
+    throw std::out_of_range("out of range");
+  } else {
+    return element(size_t(index));
+  }
+}
+
+template<typename T, size_t N>
+constexpr T& StaticDeque<T, N>::front() {
+  return element(0);
+}
+
+template<typename T, size_t N>
+constexpr const T& StaticDeque<T, N>::front() const {
+  return element(0);
+}
+
+template<typename T, size_t N>
+constexpr T& StaticDeque<T, N>::back() {
+  return element(size_ - 1);
+}
+
+template<typename T, size_t N>
+constexpr const T& StaticDeque<T, N>::back() const {
+  return element(size_ - 1);
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::push_front(const T& element) {
+  emplace_front(element);
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::push_front(T&& element) {
+  emplace_front(std::move(element));
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::push_back(const T& element) {
+  emplace_back(element);
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::push_back(T&& element) {
+  emplace_back(std::move(element));
+}
+
+template<typename T, size_t N>
+template<typename... Args>
+constexpr T& StaticDeque<T, N>::emplace_front(Args&&... args) {
+  check_room();
+  size_t first = (head_ - 1) & MASK_;
+  T* target = std::construct_at(&slots_[first].value, std::forward<Args>(args)...);
+  head_ = first;
+  ++size_;
+  return *target;
+}
+
+template<typename T, size_t N>
+template<typename... Args>
+constexpr T& StaticDeque<T, N>::emplace_back(Args&&... args) {
+  check_room();
+  T* target = std::construct_at(&slots_[(head_ + size_) & MASK_].value, std::forward<Args>(args)...);
+  ++size_;
+  return *target;
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::pop_front() {
+  if (size_ == 0) {
+    throw std::out_of_range("deque is empty");
+  }
+  std::destroy_at(&element(0));
+  head_ = (head_ + 1) & MASK_;
+  --size_;
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::pop_back() {
+  if (size_ == 0) {
+    throw std::out_of_range("deque is empty");
+  }
+  std::destroy_at(&element(size_ - 1));
+  --size_;
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::clear() noexcept {
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    for (size_t i = 0; i < size_; ++i) {
+      std::destroy_at(&element(i));
+    }
+  }
+  head_ = 0;
+  size_ = 0;
+}
+
+// all or nothing: if an element throws or does not fit, the ones appended so far are popped again
+template<typename T, size_t N>
+template<typename InputIt>
+constexpr void StaticDeque<T, N>::append(InputIt first, InputIt last) {
+  size_t old_size = size_;
+  try {
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  } catch (...) {
+    while (size_ > old_size) {
+      pop_back();
+    }
+    throw;
+  }
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::resize(size_t count) {
+  if (count > N) {
+    throw std::length_error("static deque is full");
+  }
+  while (size_ > count) {
+    pop_back();
+  }
+  while (size_ < count) {
+    emplace_back();
+  }
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::resize(size_t count, const T& element) {
+  if (count > N) {
+    throw std::length_error("static deque is full");
+  }
+  while (size_ > count) {
+    pop_back();
+  }
+  while (size_ < count) {
+    emplace_back(element);
+  }
+}
+
+// the new element goes in at the back and is rotated into place
+template<typename T, size_t N>
+template<typename... Args>
+constexpr typename StaticDeque<T, N>::iterator StaticDeque<T, N>::emplace(iterator pos, Args&&... args) {
+  ssize_t index = pos - begin();
+  emplace_back(std::forward<Args>(args)...);
+  std::rotate(begin() + index, end() - 1, end());
+  return begin() + index;
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::insert(iterator pos, const T& element) {
+  emplace(pos, element);
+}
+
+template<typename T, size_t N>
+constexpr void StaticDeque<T, N>::insert(iterator pos, T&& element) {
+  emplace(pos, std::move(element));
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::iterator StaticDeque<T, N>::erase(iterator pos) {
+  return erase(pos, pos + 1);
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::iterator StaticDeque<T, N>::erase(iterator first, iterator last) {
+  ssize_t index = first - begin();
+  ssize_t count = last - first;
+  if (count == 0) {
+    // the move below would assign every element after first onto itself
+    return first;
+  }
+  std::move(last, end(), first);
+  for (ssize_t i = 0; i < count; ++i) {
+    pop_back();
+  }
+  return begin() + index;
+}
+
+// a position counted from slot 0 without masking, so end() is one past the last element even when the
+// ring wraps
+template<typename T, size_t N>
+template<bool is_const>
+class StaticDeque<T, N>::CommonIterator {
+ private:
+  using slot_pointer = typename std::conditional<is_const, const Slot*, Slot*>::type;
+
+  slot_pointer slots_ = nullptr;
+  size_t position_ = 0;
+
+ public:
+  constexpr CommonIterator() = default;
+
+  constexpr CommonIterator(slot_pointer slots, size_t position) noexcept;
+
+  using value_type = T;
+  using iterator_category = std::random_access_iterator_tag;
+  using difference_type = ssize_t;
+  using reference = typename std::conditional<is_const, const T&, T&>::type;
+  using pointer = typename std::conditional<is_const, const T*, T*>::type;
+
+  constexpr operator CommonIterator<true>() const noexcept;
+
+  constexpr const CommonIterator<is_const> operator--(int) noexcept;
+  constexpr const CommonIterator<is_const> operator++(int) noexcept;
+  constexpr CommonIterator<is_const>& operator--() noexcept;
+  constexpr CommonIterator<is_const>& operator++() noexcept;
+  constexpr CommonIterator<is_const>& operator+=(difference_type) noexcept;
+  constexpr CommonIterator<is_const>& operator-=(difference_type) noexcept;
+  constexpr CommonIterator<is_const> operator+(difference_type) const noexcept;
+  constexpr CommonIterator<is_const> operator-(difference_type) const noexcept;
+
+  constexpr reference operator*() const;
+  constexpr pointer operator->() const;
+  constexpr reference operator[](difference_type) const;
+
+  constexpr difference_type operator-(const CommonIterator<is_const>&) const noexcept;
+  constexpr bool operator<(const CommonIterator<is_const>&) const noexcept;
+  constexpr bool operator==(const CommonIterator<is_const>&) const noexcept;
+  constexpr bool operator>(const CommonIterator<is_const>&) const noexcept;
+  constexpr bool operator<=(const CommonIterator<is_const>&) const noexcept;
+  constexpr bool operator>=(const CommonIterator<is_const>&) const noexcept;
+  constexpr bool operator!=(const CommonIterator<is_const>&) const noexcept;
+};
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr StaticDeque<T, N>::CommonIterator<is_const>::CommonIterator(slot_pointer slots, size_t position) noexcept
+    : slots_(slots), position_(position) {}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr StaticDeque<T, N>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
+  return CommonIterator<true>(slots_, position_);
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr const typename StaticDeque<T, N>::template CommonIterator<is_const>
+StaticDeque<T, N>::CommonIterator<is_const>::operator--(int) noexcept {
+  CommonIterator temp_iterator(*this);
+  --position_;
+  return temp_iterator;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr const typename StaticDeque<T, N>::template CommonIterator<is_const>
+StaticDeque<T, N>::CommonIterator<is_const>::operator++(int) noexcept {
+  CommonIterator temp_iterator(*this);
+  ++position_;
+  return temp_iterator;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>&
+StaticDeque<T, N>::CommonIterator<is_const>::operator--() noexcept {
+  --position_;
+  return *this;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>&
+StaticDeque<T, N>::CommonIterator<is_const>::operator++() noexcept {
+  ++position_;
+  return *this;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>&
+StaticDeque<T, N>::CommonIterator<is_const>::operator+=(difference_type delta) noexcept {
+  position_ += delta;
+  return *this;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>&
+StaticDeque<T, N>::CommonIterator<is_const>::operator-=(difference_type delta) noexcept {
+  position_ -= delta;
+  return *this;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>
+StaticDeque<T, N>::CommonIterator<is_const>::operator+(difference_type delta) const noexcept {
+  CommonIterator<is_const> result(*this);
+  return result += delta;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>
+StaticDeque<T, N>::CommonIterator<is_const>::operator-(difference_type delta) const noexcept {
+  CommonIterator<is_const> result(*this);
+  return result -= delta;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>::reference
+StaticDeque<T, N>::CommonIterator<is_const>::operator*() const {
+  return slots_[position_ & MASK_].value;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>::pointer
+StaticDeque<T, N>::CommonIterator<is_const>::operator->() const {
+  return &slots_[position_ & MASK_].value;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>::reference
+StaticDeque<T, N>::CommonIterator<is_const>::operator[](difference_type delta) const {
+  return slots_[(position_ + delta) & MASK_].value;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr typename StaticDeque<T, N>::template CommonIterator<is_const>::difference_type
+StaticDeque<T, N>::CommonIterator<is_const>::operator-(const CommonIterator<is_const>& other) const noexcept {
+  return difference_type(position_ - other.position_);
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr bool StaticDeque<T, N>::CommonIterator<is_const>::operator<(
+    const CommonIterator<is_const>& other) const noexcept {
+  return position_ < other.position_;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr bool StaticDeque<T, N>::CommonIterator<is_const>::operator==(
+    const CommonIterator<is_const>& other) const noexcept {
+  return position_ == other.position_;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr bool StaticDeque<T, N>::CommonIterator<is_const>::operator>(
+    const CommonIterator<is_const>& other) const noexcept {
+  return other < *this;
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr bool StaticDeque<T, N>::CommonIterator<is_const>::operator<=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(other < *this);
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr bool StaticDeque<T, N>::CommonIterator<is_const>::operator>=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this < other);
+}
+
+template<typename T, size_t N>
+template<bool is_const>
+constexpr bool StaticDeque<T, N>::CommonIterator<is_const>::operator!=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this == other);
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::iterator StaticDeque<T, N>::begin() noexcept {
+  return iterator(slots_, head_);
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_iterator StaticDeque<T, N>::begin() const noexcept {
+  return const_iterator(slots_, head_);
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::iterator StaticDeque<T, N>::end() noexcept {
+  return iterator(slots_, head_ + size_);
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_iterator StaticDeque<T, N>::end() const noexcept {
+  return const_iterator(slots_, head_ + size_);
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_iterator StaticDeque<T, N>::cbegin() const noexcept {
+  return begin();
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_iterator StaticDeque<T, N>::cend() const noexcept {
+  return end();
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::reverse_iterator StaticDeque<T, N>::rbegin() noexcept {
+  return reverse_iterator(end());
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_reverse_iterator StaticDeque<T, N>::rbegin() const noexcept {
+  return const_reverse_iterator(end());
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_reverse_iterator StaticDeque<T, N>::crbegin() const noexcept {
+  return const_reverse_iterator(end());
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::reverse_iterator StaticDeque<T, N>::rend() noexcept {
+  return reverse_iterator(begin());
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_reverse_iterator StaticDeque<T, N>::rend() const noexcept {
+  return const_reverse_iterator(begin());
+}
+
+template<typename T, size_t N>
+constexpr typename StaticDeque<T, N>::const_reverse_iterator StaticDeque<T, N>::crend() const noexcept {
+  return const_reverse_iterator(begin());
+}
+
+template<typename T, size_t N>
+std::array<typename StaticDeque<T, N>::segment, 2> StaticDeque<T, N>::segments() noexcept {
+  T* base = &slots_[0].value;
+  size_t first = std::min(size_, SLOTS_ - head_);
+  return {segment(base + head_, first), segment(base, size_ - first)};
+}
+
+template<typename T, size_t N>
+std::array<typename StaticDeque<T, N>::const_segment, 2> StaticDeque<T, N>::segments() const noexcept {
+  const T* base = &slots_[0].value;
+  size_t first = std::min(size_, SLOTS_ - head_);
+  return {const_segment(base + head_, first), const_segment(base, size_ - first)};
+}
+
+template<typename T, size_t N>
+template<typename Func>
+void StaticDeque<T, N>::for_each_segment(Func&& func) {
+  for (segment piece: segments()) {
+    if (!piece.empty()) {
+      func(piece);
+    }
+  }
+}
+
+template<typename T, size_t N>
+template<typename Func>
+void StaticDeque<T, N>::for_each_segment(Func&& func) const {
+  for (const_segment piece: segments()) {
+    if (!piece.empty()) {
+      func(piece);
+    }
+  }
+}
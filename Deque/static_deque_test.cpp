@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "static_deque.h"
+
+struct Counted {
+  static int alive;
+
+  int x = 0;
+
+  Counted(int x) : x(x) { ++alive; }
+  Counted(const Counted& other) : x(other.x) { ++alive; }
+  Counted& operator=(const Counted& other) = default;
+  ~Counted() { --alive; }
+};
+
+int Counted::alive = 0;
+
+constexpr int FrontBackSum() {
+  StaticDeque<int, 5> d;
+  for (int i = 1; i <= 20; ++i) {
+    d.push_back(i);
+    if (d.full()) {
+      d.pop_front();
+    }
+  }
+  d.push_front(100);
+  d.erase(d.begin() + 1);
+  d.insert(d.end() - 1, 7);
+  StaticDeque<int, 5> copy(d);
+  std::sort(copy.begin(), copy.end());
+  return copy.front() * 1000 + copy.back() + int(copy.size()) * 100'000;
+}
+
+constexpr size_t StringDeque() {
+  StaticDeque<std::string, 3> words(2, "ab");
+  words.emplace_front(10, 'x');
+  words.pop_back();
+  StaticDeque<std::string, 3> moved(std::move(words));
+  return moved.front().size() + moved.back().size() + words.size();
+}
+
+// the same code runs at compile time, where a push into a full deque would not compile
+static_assert(FrontBackSum() == 5 * 100'000 + 7 * 1000 + 100);
+static_assert(StringDeque() == 12);
+static_assert(StaticDeque<int, 5>::capacity() == 5);
+
+template<typename Static>
+std::vector<int> Contents(const Static& d) {
+  std::vector<int> result;
+  d.for_each_segment([&](auto piece) {
+    result.insert(result.end(), piece.begin(), piece.end());
+  });
+  assert(std::equal(result.begin(), result.end(), d.begin(), d.end()));
+  assert(std::equal(result.rbegin(), result.rend(), d.rbegin(), d.rend()));
+  return result;
+}
+
+void test1() {
+  assert(FrontBackSum() == 5 * 100'000 + 7 * 1000 + 100);
+  assert(StringDeque() == 12);
+
+  // capacity 6 sits in 8 slots, so the elements wrap at every place over the run
+  std::mt19937 generator(25);
+  StaticDeque<int, 6> d;
+  std::deque<int> reference;
+  for (int step = 0; step < 20'000; ++step) {
+    int value = int(generator() % 1000);
+    switch (generator() % 4) {
+      case 0:
+        if (!d.full()) {
+          d.push_back(value);
+          reference.push_back(value);
+        }
+        break;
+      case 1:
+        if (!d.full()) {
+          d.emplace_front(value);
+          reference.push_front(value);
+        }
+        break;
+      case 2:
+        if (!reference.empty()) {
+          d.pop_back();
+          reference.pop_back();
+        }
+        break;
+      default:
+        if (!reference.empty()) {
+          d.pop_front();
+          reference.pop_front();
+        }
+    }
+    assert(d.size() == reference.size());
+    assert(Contents(d) == std::vector<int>(reference.begin(), reference.end()));
+    if (!reference.empty()) {
+      assert(d.front() == reference.front() && d.back() == reference.back());
+      assert(d[reference.size() / 2] == reference[reference.size() / 2]);
+    }
+  }
+
+  StaticDeque<int, 4> small(4, 9);
+  bool thrown = false;
+  try {
+    small.push_front(1);
+  } catch (const std::length_error&) {
+    thrown = true;
+  }
+  assert(thrown && small.size() == 4 && small.front() == 9);
+  thrown = false;
+  try {
+    small.at(4);
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  assert(thrown);
+  small.clear();
+  thrown = false;
+  try {
+    small.pop_front();
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // a range that does not fit leaves the deque as it was
+  std::vector<int> values(10);
+  std::iota(values.begin(), values.end(), 0);
+  small.push_back(-1);
+  thrown = false;
+  try {
+    small.append(values.begin(), values.end());
+  } catch (const std::length_error&) {
+    thrown = true;
+  }
+  assert(thrown && (Contents(small) == std::vector<int>{-1}));
+  StaticDeque<int, 10> all(values.begin(), values.end());
+  all.erase(all.begin() + 2, all.begin() + 5);
+  assert((Contents(all) == std::vector<int>{0, 1, 5, 6, 7, 8, 9}));
+  all.resize(3);
+  all.resize(5, 4);
+  assert((Contents(all) == std::vector<int>{0, 1, 5, 4, 4}));
+}
+
+void test2() {
+  {
+    StaticDeque<Counted, 5> d;
+    for (int i = 0; i < 4; ++i) {
+      d.emplace_back(-1);
+      d.pop_front();
+    }
+    for (int i = 0; i < 5; ++i) {
+      d.emplace_back(i);
+    }
+    assert(Counted::alive == 5 && d.front().x == 0 && d.back().x == 4);
+    StaticDeque<Counted, 5> copy(d);
+    assert(Counted::alive == 10);
+    copy.pop_back();
+    copy.pop_back();
+    swap(d, copy);
+    assert(d.size() == 3 && copy.size() == 5 && Counted::alive == 8);
+    d = copy;
+    assert(d.size() == 5 && Counted::alive == 10);
+    copy = std::move(d);
+    assert(d.size() == 0 && copy.back().x == 4 && Counted::alive == 5);
+    copy.pop_front();
+    copy.insert(copy.begin() + 2, Counted(-1));
+    assert(copy[2].x == -1 && copy[3].x == 3 && Counted::alive == 5);
+  }
+  assert(Counted::alive == 0);
+
+  // erasing an empty range leaves every element alone
+  StaticDeque<std::vector<int>, 6> vectors;
+  for (int i = 0; i < 6; ++i) {
+    vectors.push_back(std::vector<int>(3, i));
+  }
+  for (ssize_t index: {0, 2, 6}) {
+    auto it = vectors.erase(vectors.begin() + index, vectors.begin() + index);
+    assert(it - vectors.begin() == index && vectors.size() == 6);
+  }
+  for (int i = 0; i < 6; ++i) {
+    assert(vectors[i] == std::vector<int>(3, i));
+  }
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -3,10 +3,40 @@
 #include <iostream>
 #include <cassert>
 #include <deque>
+#include <array>
+#include <random>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <list>
+#include <iterator>
+#include <vector>
+#include <cstdlib>
+#include <new>
 
 #include "deque.h"
 
+// when set to n > 0, the n-th operator new from now on throws
+static size_t fail_allocation = 0;
+
+void* operator new(size_t bytes) {
+  if (fail_allocation > 0 && --fail_allocation == 0) {
+    throw std::bad_alloc();
+  }
+  if (void* pointer = std::malloc(bytes == 0 ? 1 : bytes)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
 //template <typename T>
 //using Deque = std::deque<T>;
 
@@ -273,6 +303,822 @@ void test7() {
 
 }
 
+struct MoveOnly {
+  std::unique_ptr<int> value;
+
+  MoveOnly(int x) : value(std::make_unique<int>(x)) {}
+};
+
+void test8() {
+  Deque<std::string> d;
+  std::string s(100, 'a');
+
+  d.push_back(std::move(s));
+  assert(s.empty());
+  d.emplace_back(3, 'b');
+  d.emplace_front("front");
+  d.emplace(d.begin() + 1, 2, 'c');
+  assert(d.size() == 4);
+  assert(d[0] == "front" && d[1] == "cc" && d[2].size() == 100 && d[3] == "bbb");
+
+  Deque<std::string> moved(std::move(d));
+  assert(moved.size() == 4 && d.size() == 0);
+  assert(moved[3] == "bbb");
+
+  d.push_front("reused");
+  assert(d.size() == 1 && d[0] == "reused");
+
+  d = std::move(moved);
+  assert(d.size() == 4 && moved.size() == 0);
+  assert(d[0] == "front");
+
+  Deque<MoveOnly> md;
+  for (int i = 0; i < 100; ++i) {
+    md.emplace_back(i);
+    md.push_front(MoveOnly(-i));
+  }
+  assert(md.size() == 200);
+  assert(*md[0].value == -99 && *md[199].value == 99);
+}
+
+struct ThrowingAssign {
+  static int assignments_left;
+
+  int x = 0;
+  ThrowingAssign(int x) : x(x) {}
+  ThrowingAssign(const ThrowingAssign&) = default;
+
+  ThrowingAssign& operator=(const ThrowingAssign& other) {
+    if (assignments_left-- == 0) {
+      throw std::runtime_error("Boom!");
+    }
+    x = other.x;
+    return *this;
+  }
+};
+
+int ThrowingAssign::assignments_left = -1;
+
+void test9() {
+  Deque<int> d;
+  std::deque<int> stl_d;
+  for (int i = 0; i < 1000; ++i) {
+    size_t index = (i * 7919) % (d.size() + 1);
+    d.insert(d.begin() + index, i);
+    stl_d.insert(stl_d.begin() + index, i);
+  }
+  assert(d.size() == stl_d.size());
+  for (size_t i = 0; i < d.size(); ++i) {
+    assert(d[i] == stl_d[i]);
+  }
+
+  for (size_t index: {3, 97}) {
+    Deque<ThrowingAssign> td;
+    for (int i = 0; i < 100; ++i) {
+      td.push_back(i);
+    }
+    for (int fail_at = 0; fail_at < 3; ++fail_at) {
+      ThrowingAssign::assignments_left = fail_at;
+      try {
+        td.insert(td.begin() + index, -1);
+        assert(false);
+      } catch (std::runtime_error&) {}
+      ThrowingAssign::assignments_left = -1;
+      assert(td.size() == 100);
+      for (int i = 0; i < 100; ++i) {
+        assert(td[i].x == i);
+      }
+    }
+  }
+}
+
+struct Counted {
+  static int alive;
+
+  int x = 0;
+  Counted(int x) : x(x) {
+    ++alive;
+  }
+  Counted(const Counted& other) : x(other.x) {
+    ++alive;
+  }
+  Counted& operator=(const Counted&) = default;
+  ~Counted() {
+    --alive;
+  }
+};
+
+int Counted::alive = 0;
+
+void test10() {
+  {
+    Deque<Counted> d;
+    std::deque<int> stl_d;
+    for (int i = 0; i < 2000; ++i) {
+      d.push_back(i);
+      stl_d.push_back(i);
+    }
+    for (int i = 0; i < 500; ++i) {
+      size_t index = (i * 7919) % d.size();
+      auto it = d.erase(d.begin() + index);
+      stl_d.erase(stl_d.begin() + index);
+      assert(size_t(it - d.begin()) == index);
+    }
+    assert(Counted::alive == 1500);
+
+    d.erase(d.begin() + 10, d.begin() + 110);
+    stl_d.erase(stl_d.begin() + 10, stl_d.begin() + 110);
+    d.erase(d.end() - 300, d.end() - 50);
+    stl_d.erase(stl_d.end() - 300, stl_d.end() - 50);
+    d.erase(d.begin() + 5, d.begin() + 5);
+    assert(Counted::alive == 1150);
+    assert(d.size() == stl_d.size());
+    for (size_t i = 0; i < d.size(); ++i) {
+      assert(d[i].x == stl_d[i]);
+    }
+
+    while (d.size() > 2) {
+      d.pop_front();
+      d.pop_back();
+    }
+    assert(Counted::alive == 2);
+  }
+  assert(Counted::alive == 0);
+}
+
+void test11() {
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> d;
+  for (int i = 0; i < 100; ++i) {
+    d.push_back(i);
+    d.push_front(-i - 1);
+  }
+  for (ssize_t a = 0; a <= 200; a += 7) {
+    for (ssize_t b = 0; b <= 200; b += 3) {
+      auto it = d.begin() + a;
+      assert((it - (d.begin() + b)) == a - b);
+      it -= a - b;
+      assert(it == d.begin() + b);
+      assert((a < b) == (d.begin() + a < d.begin() + b));
+      if (b < 200) {
+        assert(*it == d[b] && d.begin()[b] == d[b]);
+      }
+    }
+  }
+
+  std::string s;
+  for (auto it = d.crbegin(); it != d.crend(); ++it) {
+    if (*it % 25 == 0) {
+      s += std::to_string(*it);
+    }
+  }
+  assert(s == "7550250-25-50-75-100");
+
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> moved(std::move(d));
+  assert(d.begin() == d.end() && d.rbegin() == d.rend());
+}
+
+void test12() {
+  Deque<int, std::allocator<int>, FixedChunkPolicy<8>> d;
+  for (int i = 0; i < 100; ++i) {
+    d.push_back(i);
+  }
+  for (int i = 100; i < 100'000; ++i) {
+    d.push_back(i);
+    assert(d.front() == i - 100);
+    d.pop_front();
+  }
+  for (int i = 0; i < 100; ++i) {
+    assert(d[i] == 99'900 + i);
+  }
+
+  Deque<int> grown;
+  try {
+    grown.set_growth_factor(1);
+    assert(false);
+  } catch (std::invalid_argument&) {}
+  grown.set_growth_factor(4);
+  for (int i = 0; i < 10'000; ++i) {
+    grown.push_front(-i);
+    grown.push_back(i);
+  }
+  Deque<int> copy = grown;
+  assert(copy.growth_factor() == 4);
+  assert(copy.size() == 20'000 && copy.front() == -9999 && copy.back() == 9999);
+}
+
+template<typename T>
+struct CountingAllocator : public std::allocator<T> {
+  static size_t allocations;
+  static size_t live;
+
+  template<typename U>
+  struct rebind {
+    using other = CountingAllocator<U>;
+  };
+
+  CountingAllocator() = default;
+
+  template<typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    ++allocations;
+    ++live;
+    return std::allocator<T>::allocate(count);
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    --live;
+    std::allocator<T>::deallocate(ptr, count);
+  }
+};
+
+template<typename T>
+size_t CountingAllocator<T>::allocations = 0;
+
+template<typename T>
+size_t CountingAllocator<T>::live = 0;
+
+void test13() {
+  using Allocations = CountingAllocator<int>;
+  using MapAllocations = CountingAllocator<int*>;
+  {
+    Deque<int, CountingAllocator<int>, FixedChunkPolicy<16>> d;
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 1000; ++i) {
+        d.push_back(i);
+      }
+      for (int i = 0; i < 1000; ++i) {
+        d.pop_back();
+      }
+    }
+    for (int i = 0; i < 64; ++i) {
+      d.push_back(i);
+    }
+    for (int i = 0; i < 100; ++i) {
+      d.push_back(i);
+      d.pop_front();
+    }
+    size_t before = Allocations::allocations;
+    for (int i = 0; i < 100'000; ++i) {
+      d.push_back(i);
+      d.pop_front();
+    }
+    assert(Allocations::allocations == before);
+
+    d.shrink_to_fit();
+    assert(d.size() == 64 && d.front() == 100'000 - 64 && d.back() == 99'999);
+    assert(Allocations::live <= 64 / 16 + 1 && MapAllocations::live == 1);
+    d.push_front(-1);
+    d.push_back(-2);
+    assert(d.front() == -1 && d.back() == -2);
+  }
+  assert(Allocations::live == 0);
+  assert(MapAllocations::live == 0);
+}
+
+struct ThrowingCopy {
+  static int copies_left;
+  static int alive;
+
+  int x = 0;
+  ThrowingCopy(int x) : x(x) {
+    ++alive;
+  }
+  ThrowingCopy(const ThrowingCopy& other) : x(other.x) {
+    if (copies_left-- == 0) {
+      throw std::runtime_error("Boom!");
+    }
+    ++alive;
+  }
+  ~ThrowingCopy() {
+    --alive;
+  }
+};
+
+int ThrowingCopy::copies_left = -1;
+int ThrowingCopy::alive = 0;
+
+void test14() {
+  std::vector<int> v(10'000);
+  for (size_t i = 0; i < v.size(); ++i) {
+    v[i] = i;
+  }
+  Deque<int, std::allocator<int>, FixedChunkPolicy<16>> d(v.begin(), v.end());
+  std::deque<int> stl_d(v.begin(), v.end());
+
+  d.append(v.data() + 5, v.data() + 1000);
+  stl_d.insert(stl_d.end(), v.data() + 5, v.data() + 1000);
+  d.prepend(v.rbegin(), v.rbegin() + 777);
+  stl_d.insert(stl_d.begin(), v.rbegin(), v.rbegin() + 777);
+  std::list<int> l(v.begin(), v.begin() + 3);
+  d.prepend(l.begin(), l.end());
+  stl_d.insert(stl_d.begin(), l.begin(), l.end());
+  std::istringstream in("1 2 3 4 5");
+  d.prepend(std::istream_iterator<int>(in), std::istream_iterator<int>());
+  stl_d.insert(stl_d.begin(), {1, 2, 3, 4, 5});
+  assert(d.size() == stl_d.size());
+  assert(std::equal(d.begin(), d.end(), stl_d.begin()));
+
+  d.resize(20);
+  d.resize(100);
+  assert(d.size() == 100 && d[19] == stl_d[19] && d[20] == 0 && d[99] == 0);
+  d.resize(30'000, 7);
+  assert(d.size() == 30'000 && d[29'999] == 7);
+  d.assign(50, d[29'999]);
+  assert(d.size() == 50 && d.front() == 7 && d.back() == 7);
+  d.assign(0, 1);
+  d.prepend(v.begin(), v.begin() + 40);
+  assert(d.size() == 40 && d.front() == 0 && d.back() == 39);
+
+  Deque<std::string> strings(3, "x");
+  std::vector<std::string> words{"a", "b", "c", "d"};
+  strings.append(words.begin(), words.end());
+  strings.prepend(words.begin(), words.begin() + 2);
+  strings.resize(12);
+  assert(strings[0] == "a" && strings[2] == "x" && strings[8] == "d" && strings[11].empty());
+
+  {
+    std::vector<ThrowingCopy> source(v.begin(), v.begin() + 100);
+    Deque<ThrowingCopy, std::allocator<ThrowingCopy>, FixedChunkPolicy<8>> td(source.begin(), source.begin() + 10);
+    ThrowingCopy::copies_left = 50;
+    try {
+      td.append(source.begin(), source.end());
+      assert(false);
+    } catch (std::runtime_error&) {}
+    ThrowingCopy::copies_left = 50;
+    try {
+      td.prepend(source.begin(), source.end());
+      assert(false);
+    } catch (std::runtime_error&) {}
+    ThrowingCopy::copies_left = -1;
+    assert(td.size() == 10 && td.front().x == 0 && td.back().x == 9);
+    assert(ThrowingCopy::alive == 110);
+  }
+  assert(ThrowingCopy::alive == 0);
+}
+
+void test15() {
+  Deque<int, std::allocator<int>, FixedChunkPolicy<8>> d;
+  for (int i = 0; i < 50; ++i) {
+    d.push_back(i);
+  }
+  for (int i = 1; i <= 5; ++i) {
+    d.push_front(-i);
+  }
+
+  int expected = -5;
+  size_t count = 0;
+  for (auto segment: d.segments()) {
+    assert(!segment.empty() && segment.size() <= 8);
+    for (int x: segment) {
+      assert(x == expected++);
+    }
+    ++count;
+  }
+  assert(expected == 50 && count == d.segments().size());
+  assert(d.segments().begin() != d.segments().end());
+
+  d.for_each_segment([](std::span<int> segment) {
+    for (int& x: segment) {
+      x *= 2;
+    }
+  });
+  const auto& cd = d;
+  long long sum = 0;
+  cd.for_each_segment(3, 20, [&](std::span<const int> segment) {
+    for (int x: segment) {
+      sum += x;
+    }
+  });
+  long long expected_sum = 0;
+  for (int i = 3; i < 20; ++i) {
+    expected_sum += cd[i];
+  }
+  assert(sum == expected_sum);
+  assert(cd.segments(7, 7).empty() && cd.segments(7, 7).size() == 0);
+  assert(cd.segments(2, 4).size() == 1 && (*cd.segments(2, 4).begin()).size() == 2);
+
+  Deque<int> empty;
+  assert(empty.segments().begin() == empty.segments().end());
+  auto moved = std::move(d);
+  assert(d.segments().empty());
+
+  // positions in chunks that are not allocated yet stay apart
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> lazy;
+  lazy.push_back(1);
+  auto near = lazy.end() + 4;
+  auto far = lazy.end() + 8;
+  assert(near != far && near < far && far - near == 4 && (far - 4) == near);
+  assert(lazy.end() - lazy.begin() == 1 && lazy.begin() + 1 == lazy.end());
+}
+
+template<typename T, typename ChunkPolicy>
+void CheckTrivialEdits(std::mt19937& gen) {
+  Deque<T, std::allocator<T>, ChunkPolicy> d;
+  std::deque<T> stl_d;
+  for (int i = 0; i < 300; ++i) {
+    d.push_back(T{char(i)});
+    stl_d.push_back(T{char(i)});
+  }
+  for (int step = 0; step < 2000; ++step) {
+    size_t index = gen() % (stl_d.size() + 1);
+    if (step % 3 != 0 || stl_d.empty()) {
+      d.insert(d.begin() + index, T{char(step)});
+      stl_d.insert(stl_d.begin() + index, T{char(step)});
+    } else {
+      size_t count = std::min<size_t>(gen() % 20, stl_d.size() - std::min(index, stl_d.size() - 1));
+      index = std::min(index, stl_d.size() - count);
+      d.erase(d.begin() + index, d.begin() + index + count);
+      stl_d.erase(stl_d.begin() + index, stl_d.begin() + index + count);
+    }
+    assert(d.size() == stl_d.size());
+  }
+  assert(std::equal(d.begin(), d.end(), stl_d.begin()));
+
+  Deque<T, std::allocator<T>, ChunkPolicy> small(3, T{char(1)});
+  Deque<T, std::allocator<T>, ChunkPolicy> copy(d);
+  assert(std::equal(copy.begin(), copy.end(), stl_d.begin()));
+  copy = small;
+  assert(copy.size() == 3 && copy[2] == T{char(1)});
+  small = d;
+  assert(small.size() == d.size() && std::equal(small.begin(), small.end(), stl_d.begin()));
+  small = small;
+  copy.push_front(T{char(2)});
+  assert(copy.size() == 4 && copy.front() == T{char(2)});
+}
+
+void test16() {
+  std::mt19937 gen(16);
+  CheckTrivialEdits<int, FixedChunkPolicy<4>>(gen);
+  CheckTrivialEdits<int, SmallChunkPolicy>(gen);
+  CheckTrivialEdits<std::array<char, 64>, FixedChunkPolicy<2>>(gen);
+  CheckTrivialEdits<std::array<char, 64>, SmallChunkPolicy>(gen);
+
+  // copy assignment into a shorter deque keeps the old contents when setting up room throws
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> source(1000, 7);
+  for (size_t failing = 1; failing < 5; ++failing) {
+    Deque<int, std::allocator<int>, FixedChunkPolicy<4>> target(10, 3);
+    fail_allocation = failing;
+    try {
+      target = source;
+      fail_allocation = 0;
+      assert(target.size() == 1000 && target[999] == 7);
+    } catch (const std::bad_alloc&) {
+      fail_allocation = 0;
+      assert(target.size() == 10 && target[0] == 3 && target[9] == 3);
+    }
+  }
+}
+
+void test17() {
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> big;
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> small(2, 7);
+  for (int i = 0; i < 1000; ++i) {
+    big.push_back(i);
+  }
+  for (int i = 0; i < 100; ++i) {
+    big.pop_front();
+  }
+  big.set_growth_factor(3);
+  int* first = &big[0];
+
+  small.swap(big);
+  assert(small.size() == 900 && small.front() == 100 && &small[0] == first && small.growth_factor() == 3);
+  assert(big.size() == 2 && big[1] == 7 && big.growth_factor() == 2);
+  for (int i = 0; i < 1000; ++i) {
+    big.push_front(-i);
+    small.push_back(i);
+  }
+  swap(big, small);
+  assert(big.size() == 1900 && small.size() == 1002 && small.front() == -999 && big.back() == 999);
+
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> empty;
+  Deque<int, std::allocator<int>, FixedChunkPolicy<4>> moved_from = std::move(empty);
+  empty.swap(big);
+  assert(empty.size() == 1900 && big.size() == 0 && big.begin() == big.end());
+  big.push_back(1);
+  assert(big.size() == 1 && big[0] == 1);
+
+  // handing a batch to the next stage keeps the elements where they are
+  Deque<Deque<int>> stages(3);
+  stages[0].resize(10'000, 5);
+  int* batch = &stages[0][0];
+  stages[1] = std::move(stages[0]);
+  stages[2].swap(stages[1]);
+  assert(&stages[2][0] == batch && stages[2].size() == 10'000);
+  assert(stages[0].size() == 0 && stages[1].size() == 0);
+  static_assert(noexcept(std::declval<Deque<int>&>().swap(std::declval<Deque<int>&>())));
+  static_assert(noexcept(std::declval<Deque<int>&>() = std::declval<Deque<int>&&>()));
+}
+
+template<typename ChunkPolicy>
+void CheckSort(size_t count, int modulo, size_t front_count) {
+  std::mt19937 gen(count * 31 + modulo);
+  std::vector<int> values(count);
+  for (auto& value: values) {
+    value = int(gen() % modulo);
+  }
+  Deque<int, std::allocator<int>, ChunkPolicy> d;
+  for (size_t i = front_count; i < count; ++i) {
+    d.push_back(values[i]);
+  }
+  for (size_t i = front_count; i > 0; --i) {
+    d.push_front(values[i - 1]);
+  }
+  d.sort();
+  std::sort(values.begin(), values.end());
+  assert(d.size() == count && std::equal(d.begin(), d.end(), values.begin()));
+  d.sort(std::greater<>());
+  assert(std::equal(d.rbegin(), d.rend(), values.begin()));
+  d.push_back(-1);
+  d.push_front(modulo);
+  assert(d.front() == modulo && d.back() == -1);
+}
+
+void test18() {
+  for (size_t count: {0, 1, 2, 5, 100, 1000, 50'000, 300'000}) {
+    for (int modulo: {1, 3, 1'000'000}) {
+      CheckSort<FixedChunkPolicy<4>>(count, modulo, count / 3);
+      CheckSort<SmallChunkPolicy>(count, modulo, 0);
+    }
+  }
+
+  Deque<std::string> words;
+  for (int i = 0; i < 5000; ++i) {
+    words.push_back(std::to_string((i * 7919) % 5000));
+  }
+  words.sort();
+  assert(std::is_sorted(words.begin(), words.end()) && words.size() == 5000);
+
+  // the map growth settings survive a sort, whichever storage the elements end up in
+  for (size_t count: {5000, 50'000, 300'000}) {
+    Deque<int, std::allocator<int>, FixedChunkPolicy<4>> configured;
+    configured.set_growth_factor(4);
+    configured.set_incremental_growth(true);
+    for (size_t i = 0; i < count; ++i) {
+      configured.push_back(int((i * 7919) % count));
+    }
+    configured.sort();
+    assert(std::is_sorted(configured.begin(), configured.end()));
+    assert(configured.growth_factor() == 4 && configured.incremental_growth());
+  }
+
+  // copy-only elements take the iterator sort
+  Counted::alive = 0;
+  {
+    Deque<Counted, std::allocator<Counted>, FixedChunkPolicy<8>> counted;
+    for (int i = 0; i < 300; ++i) {
+      counted.push_back(Counted((i * 37) % 300));
+    }
+    counted.sort([](const Counted& a, const Counted& b) { return a.x < b.x; });
+    for (int i = 0; i < 300; ++i) {
+      assert(counted[i].x == i);
+    }
+    assert(Counted::alive == 300);
+  }
+  assert(Counted::alive == 0);
+
+  // a throwing comparator leaves every element in place, in some order
+  Deque<std::string, std::allocator<std::string>, FixedChunkPolicy<4>> names;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 2000; ++i) {
+    names.push_back(std::string(20, char('a' + i % 26)) + std::to_string(i));
+    expected.push_back(names.back());
+  }
+  for (int budget: {10, 5000, 15000}) {
+    int calls = 0;
+    bool thrown = false;
+    try {
+      names.sort([&](const std::string& a, const std::string& b) {
+        if (++calls == budget) {
+          throw std::runtime_error("comparison failed");
+        }
+        return a > b;
+      });
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    assert(thrown);
+    std::vector<std::string> left(names.begin(), names.end());
+    std::sort(left.begin(), left.end());
+    std::sort(expected.begin(), expected.end());
+    assert(left == expected);
+  }
+}
+
+void test19() {
+  using Allocations = CountingAllocator<int>;
+  using MapAllocations = CountingAllocator<int*>;
+  {
+    Deque<int, CountingAllocator<int>, FixedChunkPolicy<16>> d;
+    assert(d.capacity_back() == 0 && d.capacity_front() == 0);
+    d.push_back(0);
+    d.reserve_back(10'000);
+    d.reserve_front(3'000);
+    assert(d.capacity_back() >= 10'000 && d.capacity_front() >= 3'000);
+
+    // a reserved burst touches neither the map nor the chunk allocator
+    size_t chunks = Allocations::allocations;
+    size_t maps = MapAllocations::allocations;
+    for (int i = 1; i <= 10'000; ++i) {
+      d.push_back(i);
+    }
+    for (int i = 1; i <= 3'000; ++i) {
+      d.push_front(-i);
+    }
+    assert(Allocations::allocations == chunks && MapAllocations::allocations == maps);
+    assert(d.size() == 13'001 && d.front() == -3'000 && d.back() == 10'000);
+
+    // reserving at one end while the other end holds a reservation keeps both
+    d.reserve_front(100);
+    size_t front = d.capacity_front();
+    maps = MapAllocations::allocations;
+    d.reserve_back(1'000'000);
+    assert(MapAllocations::allocations == maps + 1);
+    assert(d.capacity_front() >= front && d.capacity_back() >= 1'000'000);
+    assert(d.size() == 13'001 && d.front() == -3'000 && d[3'000] == 0 && d.back() == 10'000);
+
+    // clear keeps every chunk for the next round
+    size_t live = Allocations::live;
+    d.clear();
+    assert(d.size() == 0 && Allocations::live == live && d.capacity_back() >= 1'000'000);
+    chunks = Allocations::allocations;
+    for (int i = 0; i < 1'000'000; ++i) {
+      d.push_back(i);
+    }
+    assert(Allocations::allocations == chunks && d[999'999] == 999'999);
+  }
+  assert(Allocations::live == 0 && MapAllocations::live == 0);
+
+  {
+    Deque<Counted, std::allocator<Counted>, FixedChunkPolicy<4>> counted;
+    counted.reserve_back(0);
+    counted.reserve_front(0);
+    for (int i = 0; i < 50; ++i) {
+      counted.push_back(i);
+    }
+    counted.clear();
+    assert(Counted::alive == 0 && counted.size() == 0 && counted.capacity_back() >= 50);
+    counted.push_front(1);
+    counted.push_back(2);
+    assert(counted.front().x == 1 && counted.back().x == 2 && Counted::alive == 2);
+  }
+  assert(Counted::alive == 0);
+
+  Deque<int> moved;
+  Deque<int> target(std::move(moved));
+  assert(moved.capacity_back() == 0 && moved.capacity_front() == 0);
+  moved.clear();
+  moved.reserve_back(100);
+  assert(moved.capacity_back() >= 100);
+}
+
+template<typename Container>
+void CheckSame(const Container& d, const std::deque<int>& expected) {
+  assert(d.size() == expected.size());
+  assert(std::equal(d.begin(), d.end(), expected.begin(), expected.end()));
+}
+
+void test20() {
+  using Allocations = CountingAllocator<int>;
+  using MapAllocations = CountingAllocator<int*>;
+  {
+    // every kind of operation, with migrations starting and finishing in between
+    std::mt19937 gen(20);
+    Deque<int, CountingAllocator<int>, FixedChunkPolicy<2>> d;
+    d.set_incremental_growth(true);
+    assert(d.incremental_growth());
+    std::deque<int> expected;
+    for (int i = 0; i < 200'000; ++i) {
+      int op = int(gen() % 100);
+      if (op < 35) {
+        d.push_back(i);
+        expected.push_back(i);
+      } else if (op < 60) {
+        d.push_front(i);
+        expected.push_front(i);
+      } else if (op < 75 && !expected.empty()) {
+        d.pop_front();
+        expected.pop_front();
+      } else if (op < 88 && !expected.empty()) {
+        d.pop_back();
+        expected.pop_back();
+      } else if (op < 93) {
+        size_t index = expected.empty() ? 0 : gen() % (expected.size() + 1);
+        d.insert(d.begin() + index, -i);
+        expected.insert(expected.begin() + index, -i);
+      } else if (op < 96 && !expected.empty()) {
+        size_t index = gen() % expected.size();
+        d.erase(d.begin() + index);
+        expected.erase(expected.begin() + index);
+      } else if (op < 97) {
+        std::vector<int> block(gen() % 50, i);
+        d.append(block.begin(), block.end());
+        expected.insert(expected.end(), block.begin(), block.end());
+        d.prepend(block.begin(), block.end());
+        expected.insert(expected.begin(), block.begin(), block.end());
+      } else if (op < 98) {
+        d.reserve_back(gen() % 100);
+        d.reserve_front(gen() % 100);
+      } else if (i % 1000 == 0) {
+        auto copy = d;
+        CheckSame(copy, expected);
+        decltype(d) moved(std::move(copy));
+        moved.push_back(1);
+        d.swap(moved);
+        d.pop_back();
+        if (i % 5000 == 0) {
+          d.shrink_to_fit();
+        }
+      }
+      if (i % 997 == 0) {
+        CheckSame(d, expected);
+      }
+    }
+    CheckSame(d, expected);
+    d.set_incremental_growth(false);
+    for (int i = 0; i < 1000; ++i) {
+      d.push_back(i);
+      expected.push_back(i);
+    }
+    CheckSame(d, expected);
+  }
+  assert(Allocations::live == 0 && MapAllocations::live == 0);
+
+  {
+    // a long run at one end spreads each growth over many pushes, each map is written once
+    Deque<int, CountingAllocator<int>, FixedChunkPolicy<4>> d;
+    d.set_incremental_growth(true);
+    size_t maps = MapAllocations::allocations;
+    for (int i = 0; i < 1'000'000; ++i) {
+      d.push_back(i);
+    }
+    for (int i = 0; i < 1'000'000; ++i) {
+      d.push_front(-i);
+    }
+    assert(d.size() == 2'000'000 && d[0] == -999'999 && d[1'999'999] == 999'999);
+    assert(d[999'999] == 0 && d[1'000'000] == 0);
+    assert(MapAllocations::allocations - maps < 40 && MapAllocations::live <= 2);
+
+    // a drifting queue keeps reusing a map of the same size
+    for (int i = 0; i < 3'000'000; ++i) {
+      d.push_back(i);
+      d.pop_front();
+    }
+    assert(d.size() == 2'000'000 && d.back() == 2'999'999 && MapAllocations::live <= 3);
+  }
+  assert(Allocations::live == 0 && MapAllocations::live == 0);
+
+  Deque<std::string> words;
+  words.set_incremental_growth(true);
+  for (int i = 0; i < 10'000; ++i) {
+    words.push_back(std::to_string(i));
+    words.emplace_front(std::to_string(-i));
+  }
+  assert(words.size() == 20'000 && words.front() == "-9999" && words.back() == "9999");
+}
+
+void test21() {
+  // an empty range is a no-op, at either side of the middle and in either layout
+  for (size_t index: {0, 2, 3, 6}) {
+    Deque<std::vector<int>> d;
+    for (int i = 0; i < 6; ++i) {
+      d.push_back(std::vector<int>(3, i));
+    }
+    auto it = d.erase(d.begin() + index, d.begin() + index);
+    assert(it - d.begin() == ssize_t(index) && d.size() == 6);
+    for (int i = 0; i < 6; ++i) {
+      assert(d[i] == std::vector<int>(3, i));
+    }
+  }
+  Deque<int> numbers;
+  numbers.push_back(1);
+  numbers.erase(numbers.end(), numbers.end());
+  assert(numbers.size() == 1 && numbers[0] == 1);
+}
+
+void test22() {
+  // a moved-from deque gets a new map on its next push, with the growth settings it had
+  for (int front = 0; front < 2; ++front) {
+    Deque<int, std::allocator<int>, FixedChunkPolicy<4>> d;
+    d.set_growth_factor(4);
+    d.set_incremental_growth(true);
+    d.push_back(1);
+    Deque<int, std::allocator<int>, FixedChunkPolicy<4>> taken(std::move(d));
+    if (front) {
+      d.push_front(2);
+    } else {
+      d.push_back(2);
+    }
+    assert(d.size() == 1 && d[0] == 2);
+    assert(d.growth_factor() == 4 && d.incremental_growth());
+    for (int i = 0; i < 1000; ++i) {
+      d.push_back(i);
+    }
+    assert(d.size() == 1001 && d.back() == 999 && taken.size() == 1);
+  }
+}
 
 int main() {
   
@@ -300,6 +1146,51 @@ int main() {
   std::cerr << "Test 6 passed.\n";
 
   test7();
+  std::cerr << "Test 7 passed.\n";
+
+  test8();
+  std::cerr << "Test 8 passed.\n";
+
+  test9();
+  std::cerr << "Test 9 passed.\n";
+
+  test10();
+  std::cerr << "Test 10 passed.\n";
+
+  test11();
+  std::cerr << "Test 11 passed.\n";
+
+  test12();
+  std::cerr << "Test 12 passed.\n";
+
+  test13();
+  std::cerr << "Test 13 passed.\n";
+
+  test14();
+  std::cerr << "Test 14 passed.\n";
+
+  test15();
+  std::cerr << "Test 15 passed.\n";
+
+  test16();
+  std::cerr << "Test 16 passed.\n";
+
+  test17();
+  std::cerr << "Test 17 passed.\n";
+
+  test18();
+  std::cerr << "Test 18 passed.\n";
+
+  test19();
+  std::cerr << "Test 19 passed.\n";
+
+  test20();
+  std::cerr << "Test 20 passed.\n";
+
+  test21();
+  std::cerr << "Test 21 passed.\n";
+
+  test22();
   std::cerr << "Tests passed, congratulations!\n";
 
   return 0;
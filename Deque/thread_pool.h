@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deque.h"
+#include "work_stealing_deque.h"
+
+// bump allocator for task objects in the spirit of StackStorage: nothing is freed one by one,
+// a block goes back to the system once the arena has moved past it and its last task has finished
+class TaskArena {
+ public:
+  struct Block {
+    std::atomic<size_t> references{1};
+    size_t bytes;
+
+    explicit Block(size_t bytes) : bytes(bytes) {}
+  };
+
+ private:
+  static constexpr size_t BLOCK_BYTES_ = 64 * 1024;
+  static constexpr size_t HEADER_BYTES_ = (sizeof(Block) + alignof(std::max_align_t) - 1) /
+                                          alignof(std::max_align_t) * alignof(std::max_align_t);
+
+  Block* current_ = nullptr;
+  unsigned char* top_ = nullptr;
+  unsigned char* end_ = nullptr;
+
+  static Block* create_block(size_t bytes);
+
+ public:
+  TaskArena() noexcept = default;
+  TaskArena(const TaskArena&) = delete;
+  TaskArena& operator=(const TaskArena&) = delete;
+  ~TaskArena() noexcept;
+
+  // the returned storage holds a reference on block until release(block)
+  void* allocate(size_t bytes, Block*& block);
+  static void release(Block*) noexcept;
+};
+
+inline TaskArena::~TaskArena() noexcept {
+  if (current_ != nullptr) {
+    release(current_);
+  }
+}
+
+inline TaskArena::Block* TaskArena::create_block(size_t bytes) {
+  void* memory = ::operator new(HEADER_BYTES_ + bytes);
+  return new (memory) Block(bytes);
+}
+
+inline void* TaskArena::allocate(size_t bytes, Block*& block) {
+  bytes = (bytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+  if (bytes > BLOCK_BYTES_ / 4) {
+    // a task this large gets a block of its own, owned by the task alone
+    block = create_block(bytes);
+    return reinterpret_cast<unsigned char*>(block) + HEADER_BYTES_;
+  }
+  if (current_ == nullptr || size_t(end_ - top_) < bytes) {
+    Block* fresh = create_block(BLOCK_BYTES_);
+    if (current_ != nullptr) {
+      release(current_);
+    }
+    current_ = fresh;
+    top_ = reinterpret_cast<unsigned char*>(fresh) + HEADER_BYTES_;
+    end_ = top_ + BLOCK_BYTES_;
+  }
+  void* result = top_;
+  top_ += bytes;
+  current_->references.fetch_add(1, std::memory_order_relaxed);
+  block = current_;
+  return result;
+}
+
+inline void TaskArena::release(Block* block) noexcept {
+  if (block->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    block->~Block();
+    ::operator delete(block);
+  }
+}
+
+// fixed set of workers, each owning a WorkStealingDeque of tasks; idle workers steal from a random victim.
+// tasks submitted from outside the pool go through a mutex-guarded Deque
+class ThreadPool {
+ private:
+  struct TaskBase {
+    void (*execute)(TaskBase*);
+    TaskArena::Block* block = nullptr;
+
+    explicit TaskBase(void (*execute)(TaskBase*)) : execute(execute) {}
+  };
+
+  template<typename F>
+  struct Task : TaskBase {
+    F func;
+
+    template<typename G>
+    explicit Task(G&& func) : TaskBase(&Task<F>::run), func(std::forward<G>(func)) {}
+
+    static void run(TaskBase* base) {
+      Task<F>* task = static_cast<Task<F>*>(base);
+      TaskArena::Block* block = task->block;
+      task->func();
+      task->~Task();
+      TaskArena::release(block);
+    }
+  };
+
+  struct Worker {
+    WorkStealingDeque<TaskBase*> deque;
+    TaskArena arena;
+  };
+
+  struct CurrentWorker {
+    ThreadPool* pool = nullptr;
+    size_t index = 0;
+  };
+
+  static constexpr size_t IDLE_SPINS_ = 64;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  std::mutex injection_mutex_;
+  Deque<TaskBase*> injection_;
+  TaskArena injection_arena_;
+  std::atomic<size_t> injected_{0};
+
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  std::atomic<size_t> sleeping_{0};
+  std::atomic<bool> stopping_{false};
+
+  static CurrentWorker& current() noexcept;
+  static std::minstd_rand& random() noexcept;
+
+  template<typename F>
+  static TaskBase* create_task(TaskArena&, F&& func);
+  template<typename F>
+  void spawn(F&& func);
+  bool run_one();
+  template<typename Predicate>
+  void help_while(Predicate&& busy);
+  void worker_loop(size_t index);
+
+  template<typename F>
+  void spawn_range(size_t first, size_t last, size_t grain, F& func, std::atomic<size_t>& remaining,
+                   std::exception_ptr& error, std::mutex& error_mutex);
+
+ public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  // runs every task already submitted before joining the workers
+  ~ThreadPool() noexcept;
+
+  size_t size() const noexcept;
+
+  // blocking on the future from inside a task can starve the pool, use parallel_for for nested work
+  template<typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& func);
+
+  // calls func(begin, end) on disjoint pieces of [first, last) no longer than grain and returns once all are done;
+  // the calling thread runs tasks meanwhile, so nesting is fine. the first exception thrown is rethrown here
+  template<typename F>
+  void parallel_for(size_t first, size_t last, size_t grain, F&& func);
+};
+
+inline ThreadPool::ThreadPool(size_t threads) {
+  threads = std::max<size_t>(threads, 1);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+  }
+}
+
+inline ThreadPool::~ThreadPool() noexcept {
+  stopping_.store(true, std::memory_order_seq_cst);
+  wake_.notify_all();
+  for (auto& thread: threads_) {
+    thread.join();
+  }
+}
+
+inline size_t ThreadPool::size() const noexcept {
+  return workers_.size();
+}
+
+inline ThreadPool::CurrentWorker& ThreadPool::current() noexcept {
+  static thread_local CurrentWorker worker;
+  return worker;
+}
+
+inline std::minstd_rand& ThreadPool::random() noexcept {
+  static thread_local std::minstd_rand gen(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  return gen;
+}
+
+template<typename F>
+ThreadPool::TaskBase* ThreadPool::create_task(TaskArena& arena, F&& func) {
+  using TaskType = Task<std::decay_t<F>>;
+  static_assert(alignof(TaskType) <= alignof(std::max_align_t), "over-aligned tasks are not supported");
+  TaskArena::Block* block = nullptr;
+  void* memory = arena.allocate(sizeof(TaskType), block);
+  TaskType* task = nullptr;
+  try {
+    task = new (memory) TaskType(std::forward<F>(func));
+  } catch (...) {
+    TaskArena::release(block);
+    throw;
+  }
+  task->block = block;
+  return task;
+}
+
+template<typename F>
+void ThreadPool::spawn(F&& func) {
+  CurrentWorker& self = current();
+  if (self.pool == this) {
+    Worker& worker = *workers_[self.index];
+    worker.deque.push(create_task(worker.arena, std::forward<F>(func)));
+  } else {
+    std::lock_guard<std::mutex> lock(injection_mutex_);
+    injection_.push_back(create_task(injection_arena_, std::forward<F>(func)));
+    injected_.fetch_add(1, std::memory_order_seq_cst);
+  }
+  if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+    wake_.notify_one();
+  }
+}
+
+// own deque first, then outside submissions, then a sweep over the other workers from a random start
+inline bool ThreadPool::run_one() {
+  CurrentWorker& self = current();
+  bool is_worker = self.pool == this;
+  std::optional<TaskBase*> task;
+  if (is_worker) {
+    task = workers_[self.index]->deque.pop();
+  }
+  if (!task && injected_.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(injection_mutex_);
+    if (injection_.size() > 0) {
+      task = injection_.front();
+      injection_.pop_front();
+      injected_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+  if (!task) {
+    size_t start = random()() % workers_.size();
+    for (size_t i = 0; i < workers_.size() && !task; ++i) {
+      size_t victim = (start + i) % workers_.size();
+      if (!is_worker || victim != self.index) {
+        task = workers_[victim]->deque.steal();
+      }
+    }
+  }
+  if (!task) {
+    return false;
+  }
+  (*task)->execute(*task);
+  return true;
+}
+
+template<typename Predicate>
+void ThreadPool::help_while(Predicate&& busy) {
+  while (busy()) {
+    if (!run_one()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+inline void ThreadPool::worker_loop(size_t index) {
+  current() = CurrentWorker{this, index};
+  size_t idle = 0;
+  while (true) {
+    if (run_one()) {
+      idle = 0;
+      continue;
+    }
+    if (stopping_.load(std::memory_order_seq_cst)) {
+      // one more sweep: a task may have been queued between the failed search and the flag
+      if (!run_one()) {
+        break;
+      }
+      continue;
+    }
+    if (++idle < IDLE_SPINS_) {
+      std::this_thread::yield();
+      continue;
+    }
+    // the timeout covers a wake-up sent just before this worker registered as sleeping
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleeping_.fetch_add(1, std::memory_order_seq_cst);
+    wake_.wait_for(lock, std::chrono::milliseconds(1));
+    sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+}
+
+template<typename F>
+std::future<std::invoke_result_t<std::decay_t<F>>> ThreadPool::submit(F&& func) {
+  using Result = std::invoke_result_t<std::decay_t<F>>;
+  std::packaged_task<Result()> task(std::forward<F>(func));
+  std::future<Result> future = task.get_future();
+  spawn([task = std::move(task)]() mutable { task(); });
+  return future;
+}
+
+template<typename F>
+void ThreadPool::spawn_range(size_t first, size_t last, size_t grain, F& func, std::atomic<size_t>& remaining,
+                             std::exception_ptr& error, std::mutex& error_mutex) {
+  spawn([this, first, last, grain, &func, &remaining, &error, &error_mutex]() mutable {
+    // keep the upper halves up for grabs and work through the lower one; if a spawn throws, the half it
+    // failed to hand out is still in [first, last) and counts as done along with ours
+    try {
+      while (last - first > grain) {
+        size_t middle = first + (last - first) / 2;
+        spawn_range(middle, last, grain, func, remaining, error, error_mutex);
+        last = middle;
+      }
+      func(first, last);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+    remaining.fetch_sub(last - first, std::memory_order_acq_rel);
+  });
+}
+
+template<typename F>
+void ThreadPool::parallel_for(size_t first, size_t last, size_t grain, F&& func) {
+  grain = std::max<size_t>(grain, 1);
+  if (last <= first) {
+    return;
+  }
+  if (last - first <= grain) {
+    func(first, last);
+    return;
+  }
+  std::atomic<size_t> remaining{last - first};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  spawn_range(first, last, grain, func, remaining, error, error_mutex);
+  help_while([&] { return remaining.load(std::memory_order_acquire) != 0; });
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,159 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "thread_pool.h"
+
+// while set, every allocation of a task arena block or larger throws
+static std::atomic<bool> fail_large_allocations{false};
+
+void* operator new(size_t bytes) {
+  if (bytes >= 64 * 1024 && fail_large_allocations.load()) {
+    throw std::bad_alloc();
+  }
+  if (void* pointer = std::malloc(bytes == 0 ? 1 : bytes)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+void test1() {
+  ThreadPool pool(4);
+  assert(pool.size() == 4);
+
+  std::vector<std::future<int>> futures;
+  for (int i = 0; i < 1000; ++i) {
+    futures.push_back(pool.submit([i] { return i * i; }));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    assert(futures[i].get() == i * i);
+  }
+
+  auto text = pool.submit([] { return std::string(100, 'x'); });
+  assert(text.get() == std::string(100, 'x'));
+
+  auto failing = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+  bool thrown = false;
+  try {
+    failing.get();
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // larger than a quarter of an arena block
+  std::array<char, 20'000> big{};
+  big[19'999] = 'z';
+  assert(pool.submit([big] { return big[19'999]; }).get() == 'z');
+
+  // tasks spawning tasks, and every submission runs before the destructor returns
+  std::atomic<int> counter{0};
+  {
+    ThreadPool inner(3);
+    for (int i = 0; i < 100; ++i) {
+      inner.submit([&] {
+        counter.fetch_add(1);
+        inner.parallel_for(0, 10, 1, [&](size_t first, size_t last) { counter.fetch_add(int(last - first)); });
+      });
+    }
+  }
+  assert(counter.load() == 100 * 11);
+}
+
+void test2() {
+  for (size_t threads: {1, 2, 5}) {
+    ThreadPool pool(threads);
+    for (size_t count: {0, 1, 7, 1000, 100'000}) {
+      for (size_t grain: {1, 16, 5000}) {
+        std::vector<std::atomic<int>> hits(count);
+        pool.parallel_for(0, count, grain, [&](size_t first, size_t last) {
+          assert(first < last && last - first <= grain);
+          for (size_t i = first; i < last; ++i) {
+            hits[i].fetch_add(1, std::memory_order_relaxed);
+          }
+        });
+        for (size_t i = 0; i < count; ++i) {
+          assert(hits[i].load() == 1);
+        }
+      }
+    }
+
+    // nested loops and a loop over an offset range
+    std::atomic<long long> sum{0};
+    pool.parallel_for(0, 100, 3, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        pool.parallel_for(1000, 2000, 64, [&](size_t begin, size_t end) {
+          long long local = 0;
+          for (size_t j = begin; j < end; ++j) {
+            local += j;
+          }
+          sum.fetch_add(local);
+        });
+      }
+    });
+    assert(sum.load() == 100LL * (1000 + 1999) * 1000 / 2);
+
+    bool thrown = false;
+    try {
+      pool.parallel_for(0, 1000, 10, [](size_t first, size_t) {
+        if (first == 500) {
+          throw std::out_of_range("500");
+        }
+      });
+    } catch (const std::out_of_range&) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+}
+
+void test3() {
+  // a task that cannot spawn its upper half reports the error, and the loop still finishes
+  for (size_t threads: {1, 4}) {
+    ThreadPool pool(threads);
+    std::atomic<size_t> done{0};
+    bool thrown = false;
+    try {
+      pool.parallel_for(0, 1'000'000, 1, [&](size_t first, size_t last) {
+        fail_large_allocations.store(true);
+        done.fetch_add(last - first);
+      });
+    } catch (const std::bad_alloc&) {
+      thrown = true;
+    }
+    fail_large_allocations.store(false);
+    assert(thrown && done.load() < 1'000'000);
+
+    std::atomic<size_t> hits{0};
+    pool.parallel_for(0, 10'000, 1, [&](size_t first, size_t last) { hits.fetch_add(last - first); });
+    assert(hits.load() == 10'000);
+  }
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Test 2 passed.\n";
+
+  test3();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include "deque.h"
+
+// Chase-Lev work-stealing deque: the owner thread pushes and pops at the bottom, any thread steals from the top.
+// slots live in power-of-two chunks reached through a circular map, so growing copies chunk pointers, never elements;
+// a replaced map is freed once no thief can still be reading it
+template<typename T, typename Allocator = std::allocator<T>, typename ChunkPolicy = SmallChunkPolicy>
+class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable_v<T>, "slots are read racily by thieves, store task pointers or handles");
+
+ private:
+  using Slot = std::atomic<T>;
+
+  struct Map {
+    size_t count;
+    Slot** chunks;
+    Map* retired_next = nullptr;
+  };
+
+  using slot_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+  using chunk_map_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot*>;
+  using map_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<Map>;
+  using SlotAllocTraits = std::allocator_traits<slot_allocator_type>;
+  using ChunkMapAllocTraits = std::allocator_traits<chunk_map_allocator_type>;
+  using MapAllocTraits = std::allocator_traits<map_allocator_type>;
+
+  static constexpr size_t MAX_SIZE_ = ChunkPolicy::template chunk_size<T>();
+  static constexpr size_t SHIFT_ = chunk_shift(MAX_SIZE_);
+  static constexpr size_t MASK_ = MAX_SIZE_ - 1;
+  static constexpr size_t START_CHUNK_COUNT_ = 4;
+  static constexpr size_t CACHE_LINE_ = 64;
+
+  slot_allocator_type slot_allocator_;
+  chunk_map_allocator_type chunk_map_allocator_;
+  map_allocator_type map_allocator_;
+  Map* retired_ = nullptr; // owner only
+
+  alignas(CACHE_LINE_) std::atomic<int64_t> top_{0};
+  std::atomic<int> active_thieves_{0};
+  alignas(CACHE_LINE_) std::atomic<int64_t> bottom_{0};
+  std::atomic<Map*> map_;
+
+  Map* create_map(size_t count);
+  void fill_chunks(Map*, uint64_t first, size_t count);
+  void destroy_map(Map*) noexcept;
+  Slot* chunk_for(Map*, int64_t index) const noexcept;
+  Map* grow(Map*, int64_t top, int64_t bottom);
+  void reclaim() noexcept;
+
+ public:
+  WorkStealingDeque();
+  explicit WorkStealingDeque(const Allocator&);
+  WorkStealingDeque(const WorkStealingDeque<T, Allocator, ChunkPolicy>&) = delete;
+  WorkStealingDeque<T, Allocator, ChunkPolicy>& operator=(const WorkStealingDeque<T, Allocator, ChunkPolicy>&) = delete;
+  ~WorkStealingDeque() noexcept;
+
+  // owner thread
+  void push(T);
+  std::optional<T> pop();
+
+  // any thread; empty also when the race for the top element was lost
+  std::optional<T> steal();
+
+  // a snapshot, exact only when no other thread is working on the deque
+  size_t size() const noexcept;
+  bool empty() const noexcept;
+};
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+WorkStealingDeque<T, Allocator, ChunkPolicy>::WorkStealingDeque()
+    : WorkStealingDeque<T, Allocator, ChunkPolicy>(Allocator()) {}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+WorkStealingDeque<T, Allocator, ChunkPolicy>::WorkStealingDeque(const Allocator& allocator)
+    : slot_allocator_(allocator), chunk_map_allocator_(allocator), map_allocator_(allocator) {
+  Map* map = create_map(START_CHUNK_COUNT_);
+  try {
+    fill_chunks(map, 0, map->count);
+  } catch (...) {
+    destroy_map(map);
+    throw;
+  }
+  map_.store(map, std::memory_order_relaxed);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+WorkStealingDeque<T, Allocator, ChunkPolicy>::~WorkStealingDeque() noexcept {
+  Map* map = map_.load(std::memory_order_relaxed);
+  // every chunk ever allocated is owned by the current map
+  for (size_t i = 0; i < map->count; ++i) {
+    SlotAllocTraits::deallocate(slot_allocator_, map->chunks[i], MAX_SIZE_);
+  }
+  destroy_map(map);
+  while (retired_ != nullptr) {
+    Map* next = retired_->retired_next;
+    destroy_map(retired_);
+    retired_ = next;
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename WorkStealingDeque<T, Allocator, ChunkPolicy>::Map* WorkStealingDeque<T, Allocator, ChunkPolicy>::create_map(
+    size_t count) {
+  Map* map = MapAllocTraits::allocate(map_allocator_, 1);
+  Slot** chunks = nullptr;
+  try {
+    chunks = ChunkMapAllocTraits::allocate(chunk_map_allocator_, count);
+  } catch (...) {
+    MapAllocTraits::deallocate(map_allocator_, map, 1);
+    throw;
+  }
+  std::fill(chunks, chunks + count, nullptr);
+  MapAllocTraits::construct(map_allocator_, map, Map{count, chunks});
+  return map;
+}
+
+// gives chunk numbers [first, first + count) fresh chunks; slots are std::atomic<T> of a trivially
+// copyable T and need no construction
+template<typename T, typename Allocator, typename ChunkPolicy>
+void WorkStealingDeque<T, Allocator, ChunkPolicy>::fill_chunks(Map* map, uint64_t first, size_t count) {
+  size_t filled = 0;
+  try {
+    for (; filled < count; ++filled) {
+      map->chunks[(first + filled) & (map->count - 1)] = SlotAllocTraits::allocate(slot_allocator_, MAX_SIZE_);
+    }
+  } catch (...) {
+    for (size_t i = 0; i < filled; ++i) {
+      SlotAllocTraits::deallocate(slot_allocator_, map->chunks[(first + i) & (map->count - 1)], MAX_SIZE_);
+    }
+    throw;
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void WorkStealingDeque<T, Allocator, ChunkPolicy>::destroy_map(Map* map) noexcept {
+  ChunkMapAllocTraits::deallocate(chunk_map_allocator_, map->chunks, map->count);
+  MapAllocTraits::destroy(map_allocator_, map);
+  MapAllocTraits::deallocate(map_allocator_, map, 1);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename WorkStealingDeque<T, Allocator, ChunkPolicy>::Slot* WorkStealingDeque<T, Allocator, ChunkPolicy>::chunk_for(
+    Map* map, int64_t index) const noexcept {
+  return map->chunks[(uint64_t(index) >> SHIFT_) & (map->count - 1)];
+}
+
+// doubles the map; the window of map->count chunk numbers starting at the top chunk covers every old slot once
+// and lands on distinct new slots, so live chunks keep their indices and spare ones stay owned.
+// the map is immutable once published, so the rest of it gets fresh chunks before that
+template<typename T, typename Allocator, typename ChunkPolicy>
+typename WorkStealingDeque<T, Allocator, ChunkPolicy>::Map* WorkStealingDeque<T, Allocator, ChunkPolicy>::grow(
+    Map* map, int64_t top, int64_t bottom) {
+  size_t count = map->count;
+  while ((uint64_t(bottom) >> SHIFT_) - (uint64_t(top) >> SHIFT_) >= count) {
+    count *= 2;
+  }
+  Map* bigger = create_map(count);
+  uint64_t first = uint64_t(top) >> SHIFT_;
+  try {
+    fill_chunks(bigger, first + map->count, count - map->count);
+  } catch (...) {
+    destroy_map(bigger);
+    throw;
+  }
+  for (uint64_t number = first; number < first + map->count; ++number) {
+    bigger->chunks[number & (count - 1)] = map->chunks[number & (map->count - 1)];
+  }
+  map_.store(bigger, std::memory_order_seq_cst);
+  map->retired_next = retired_;
+  retired_ = map;
+  reclaim();
+  return bigger;
+}
+
+// a thief registers before loading map_, so once none is registered after map_ moved on,
+// none can reach a retired map any more
+template<typename T, typename Allocator, typename ChunkPolicy>
+void WorkStealingDeque<T, Allocator, ChunkPolicy>::reclaim() noexcept {
+  if (retired_ == nullptr || active_thieves_.load(std::memory_order_seq_cst) != 0) {
+    return;
+  }
+  while (retired_ != nullptr) {
+    Map* next = retired_->retired_next;
+    destroy_map(retired_);
+    retired_ = next;
+  }
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+void WorkStealingDeque<T, Allocator, ChunkPolicy>::push(T value) {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  int64_t top = top_.load(std::memory_order_acquire);
+  Map* map = map_.load(std::memory_order_relaxed);
+  if ((uint64_t(bottom) >> SHIFT_) - (uint64_t(top) >> SHIFT_) >= map->count) {
+    map = grow(map, top, bottom);
+  } else if (retired_ != nullptr) {
+    reclaim();
+  }
+  chunk_for(map, bottom)[bottom & MASK_].store(value, std::memory_order_relaxed);
+  // publishes the slot, and the chunk and map it lives in, to thieves
+  bottom_.store(bottom + 1, std::memory_order_release);
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+std::optional<T> WorkStealingDeque<T, Allocator, ChunkPolicy>::pop() {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+  Map* map = map_.load(std::memory_order_relaxed);
+  bottom_.store(bottom, std::memory_order_seq_cst);
+  int64_t top = top_.load(std::memory_order_seq_cst);
+  if (top > bottom) {
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  T value = chunk_for(map, bottom)[bottom & MASK_].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    // the last element, race the thieves for it
+    bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    if (!won) {
+      return std::nullopt;
+    }
+  }
+  return value;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+std::optional<T> WorkStealingDeque<T, Allocator, ChunkPolicy>::steal() {
+  int64_t top = top_.load(std::memory_order_seq_cst);
+  int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+  if (top >= bottom) {
+    return std::nullopt;
+  }
+  active_thieves_.fetch_add(1, std::memory_order_seq_cst);
+  // a stale top may read a slot that is being reused, the failing CAS below discards it
+  Map* map = map_.load(std::memory_order_seq_cst);
+  T value = chunk_for(map, top)[top & MASK_].load(std::memory_order_relaxed);
+  active_thieves_.fetch_sub(1, std::memory_order_release);
+  if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+size_t WorkStealingDeque<T, Allocator, ChunkPolicy>::size() const noexcept {
+  int64_t bottom = bottom_.load(std::memory_order_acquire);
+  int64_t top = top_.load(std::memory_order_acquire);
+  return bottom > top ? size_t(bottom - top) : 0;
+}
+
+template<typename T, typename Allocator, typename ChunkPolicy>
+bool WorkStealingDeque<T, Allocator, ChunkPolicy>::empty() const noexcept {
+  return size() == 0;
+}
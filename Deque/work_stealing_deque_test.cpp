@@ -0,0 +1,101 @@
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_deque.h"
+
+void test1() {
+  WorkStealingDeque<int, std::allocator<int>, FixedChunkPolicy<4>> d;
+  assert(d.empty() && !d.pop() && !d.steal());
+
+  // the owner end is LIFO, the thief end FIFO, across several map doublings
+  for (int i = 0; i < 100; ++i) {
+    d.push(i);
+  }
+  assert(d.size() == 100);
+  for (int i = 0; i < 30; ++i) {
+    assert(*d.steal() == i);
+  }
+  for (int i = 99; i >= 70; --i) {
+    assert(*d.pop() == i);
+  }
+  // the window now starts mid-map, growing again must keep it intact
+  for (int i = 100; i < 300; ++i) {
+    d.push(i);
+  }
+  for (int i = 30; i < 70; ++i) {
+    assert(*d.steal() == i);
+  }
+  for (int i = 299; i >= 100; --i) {
+    assert(*d.pop() == i);
+  }
+  assert(d.empty() && !d.pop() && !d.steal());
+
+  d.push(7);
+  assert(*d.pop() == 7 && !d.pop());
+  d.push(8);
+  assert(*d.steal() == 8 && !d.steal());
+}
+
+template<typename ChunkPolicy>
+void CheckStealing(int count, int thieves) {
+  WorkStealingDeque<int, std::allocator<int>, ChunkPolicy> d;
+  std::vector<std::atomic<int>> taken(count);
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thieves; ++t) {
+    threads.emplace_back([&] {
+      while (!done.load(std::memory_order_acquire) || !d.empty()) {
+        if (auto value = d.steal()) {
+          taken[*value].fetch_add(1, std::memory_order_relaxed);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  // bursts of pushes let the map grow while thieves are reading it
+  int next = 0;
+  while (next < count) {
+    int burst = std::min(count - next, 1 + next % 1000);
+    for (int i = 0; i < burst; ++i) {
+      d.push(next++);
+    }
+    for (int i = 0; i < burst / 2; ++i) {
+      if (auto value = d.pop()) {
+        taken[*value].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    if (next % 7 == 0) {
+      std::this_thread::yield();
+    }
+  }
+  while (auto value = d.pop()) {
+    taken[*value].fetch_add(1, std::memory_order_relaxed);
+  }
+  done.store(true, std::memory_order_release);
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  for (int i = 0; i < count; ++i) {
+    assert(taken[i].load() == 1);
+  }
+}
+
+void test2() {
+  CheckStealing<FixedChunkPolicy<2>>(100'000, 3);
+  CheckStealing<FixedChunkPolicy<32>>(300'000, 2);
+  CheckStealing<SmallChunkPolicy>(300'000, 4);
+}
+
+int main() {
+  test1();
+  std::cerr << "Test 1 passed.\n";
+
+  test2();
+  std::cerr << "Tests passed, congratulations!\n";
+
+  return 0;
+}
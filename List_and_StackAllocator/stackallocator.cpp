@@ -134,7 +134,7 @@ class List {
     Node(const T& value) : value(value) {}
   };
 
-  using inner_allocator_type = typename Allocator::template rebind<Node>::other;
+  using inner_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
   inner_allocator_type allocator_;
 
   size_t size_;
@@ -13,6 +13,7 @@
 #include <sys/resource.h>
 
 #include "stackallocator.cpp"
+#include "../Deque/deque.h"
 //#include "correct.cpp"
 //#include "list.h"
 
@@ -373,9 +374,10 @@ struct WhimsicalAllocator : public std::allocator<T> {
 template<typename T, bool PropagateOnConstruct, bool PropagateOnAssign>
 size_t WhimsicalAllocator<T, PropagateOnConstruct, PropagateOnAssign>::counter = 0;
 
+template<template<typename, typename> class Container>
 void TestWhimsicalAllocator() {
   {
-    List<int, WhimsicalAllocator<int, true, true>> lst;
+    Container<int, WhimsicalAllocator<int, true, true>> lst;
 
     lst.push_back(1);
     lst.push_back(2);
@@ -387,7 +389,7 @@ void TestWhimsicalAllocator() {
     assert(copy.get_allocator() == lst.get_allocator());
   }
   {
-    List<int, WhimsicalAllocator<int, false, false>> lst;
+    Container<int, WhimsicalAllocator<int, false, false>> lst;
 
     lst.push_back(1);
     lst.push_back(2);
@@ -399,7 +401,7 @@ void TestWhimsicalAllocator() {
     assert(copy.get_allocator() == lst.get_allocator());
   }
   {
-    List<int, WhimsicalAllocator<int, true, false>> lst;
+    Container<int, WhimsicalAllocator<int, true, false>> lst;
 
     lst.push_back(1);
     lst.push_back(2);
@@ -466,11 +468,11 @@ int ListPerformanceTest(List&& l) {
   return duration_cast<milliseconds>(finish - start).count();
 }
 
-template<typename Alloc>
+template<template<typename, typename> class Container, typename Alloc>
 void DequeTest() {
   Alloc alloc(STATIC_STORAGE);
 
-  std::deque<char, Alloc> d(alloc);
+  Container<char, Alloc> d(alloc);
 
   d.push_back(1);
   assert(d.back() == 1);
@@ -622,13 +624,21 @@ int main() {
 
   std::cerr << "Test 5 (NotDefaultConstructible) passed." << std::endl;
 
-  DequeTest<StackAllocator<char, STORAGE_SIZE>>();
+  DequeTest<std::deque, StackAllocator<char, STORAGE_SIZE>>();
+
+  std::cerr << "Test 6 (Deque with StackAllocator) passed. Now will repeat with your Deque" << std::endl;
+
+  DequeTest<Deque, StackAllocator<char, STORAGE_SIZE>>();
+
+  std::cerr << "Test 6 with your Deque passed." << std::endl;
+
+  TestWhimsicalAllocator<List>();
 
-  std::cerr << "Test 6 (Deque with StackAllocator) passed." << std::endl;
+  std::cerr << "Test 7 (Allocator Awareness) passed. Now will repeat with your Deque" << std::endl;
 
-  TestWhimsicalAllocator();
+  TestWhimsicalAllocator<Deque>();
 
-  std::cerr << "Test 7 (Allocator Awareness) passed." << std::endl;
+  std::cerr << "Test 7 with your Deque passed." << std::endl;
 
   std::cerr << "Starting performance test. First, let's test performance of different allocators with std::list."
             << std::endl;